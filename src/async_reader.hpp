@@ -0,0 +1,450 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#if __has_include(<linux/io_uring.h>)
+#define ABKNTFS_IO_URING 1
+#include <cerrno>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace abkntfs {
+    // 一次向量读取中的一段缓冲区
+    struct IoSlice {
+        char *buf;
+        uint64_t len;
+    };
+
+    // 延迟直方图, 第 i 个桶统计延迟在 [2^i, 2^(i+1)) 微秒的请求数
+    // (第 0 个桶包含 0).
+    class LatencyHistogram {
+    public:
+        static const uint32_t BucketCount = 32;
+
+        struct Snapshot {
+            uint64_t count;
+            // 单位: 微秒
+            uint64_t totalUs;
+            uint64_t maxUs;
+            uint64_t buckets[BucketCount];
+
+            // 第 p 百分位 (0~100) 所在桶的上界 (单位: 微秒)
+            uint64_t Percentile(double p) const {
+                uint64_t need = (uint64_t)(count * p / 100.0 + 0.5), sum = 0;
+                for (uint32_t i = 0; i < BucketCount; i++) {
+                    sum += buckets[i];
+                    if (sum >= need && sum) return 2ull << i;
+                }
+                return 0;
+            }
+        };
+
+    private:
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalUs{0};
+        std::atomic<uint64_t> maxUs{0};
+        std::atomic<uint64_t> buckets[BucketCount] = {};
+
+    public:
+        void Record(uint64_t us) {
+            uint32_t b = 0;
+            while ((us >> (b + 1)) && b < BucketCount - 1) {
+                b++;
+            }
+            buckets[b]++;
+            count++;
+            totalUs += us;
+            uint64_t m = maxUs;
+            while (us > m && !maxUs.compare_exchange_weak(m, us)) {
+            }
+        }
+
+        Snapshot Get() const {
+            Snapshot ret = {count, totalUs, maxUs, {}};
+            for (uint32_t i = 0; i < BucketCount; i++) {
+                ret.buckets[i] = buckets[i];
+            }
+            return ret;
+        }
+
+        void Reset() {
+            count = totalUs = maxUs = 0;
+            for (auto &i : buckets) {
+                i = 0;
+            }
+        }
+    };
+
+    // 异步读取引擎. 请求提交后立即返回, 完成时调用回调 (或设置 future).
+    // Linux 下优先使用 io_uring, 不可用时 (内核过旧, 被 seccomp 禁止,
+    // 内存映射模式等) 退化为 queueDepth 个线程执行同步读取.
+    class AsyncReader {
+    public:
+        // 同步读取函数, 从 pos 开始依次填充 slices, 返回实际读取的字节数.
+        using ReadFunc =
+            std::function<uint64_t(uint64_t, std::vector<IoSlice> const &)>;
+        // 参数为实际读取的字节数, 小于请求的大小表示读取失败. 回调在引擎的
+        // 线程中执行, 不能抛出异常.
+        using Callback = std::function<void(uint64_t)>;
+
+        static const uint32_t DefaultQueueDepth = 32;
+        static const uint32_t MaxQueueDepth = 256;
+
+        enum Backend { BACKEND_THREAD_POOL, BACKEND_IO_URING };
+
+    private:
+        struct Request {
+            uint64_t pos;
+            std::vector<IoSlice> slices;
+            // 请求的总字节数
+            uint64_t size;
+            // 已读取的字节数
+            uint64_t done;
+            Callback cb;
+            std::chrono::steady_clock::time_point start;
+#ifdef ABKNTFS_IO_URING
+            std::vector<iovec> iov;
+            // 第一个未读满的 iov
+            size_t first;
+#endif
+        };
+
+        ReadFunc readFunc;
+        uint32_t queueDepth;
+        std::atomic<Backend> backend{BACKEND_THREAD_POOL};
+        std::mutex lock;
+        std::condition_variable pendingCv;
+        std::condition_variable idleCv;
+        std::deque<Request *> pending;
+        // 已提交未完成的请求数
+        uint64_t outstanding = 0;
+        bool stopping = false;
+        std::vector<std::thread> threads;
+        LatencyHistogram latency;
+
+        void Complete(Request *req) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - req->start);
+            latency.Record((uint64_t)us.count());
+            req->cb(req->done);
+            delete req;
+            std::lock_guard<std::mutex> guard(lock);
+            if (--outstanding == 0) {
+                idleCv.notify_all();
+            }
+        }
+
+        // 取出一个待处理的请求, 停止且队列为空时返回空指针.
+        Request *PopPending() {
+            std::unique_lock<std::mutex> l(lock);
+            pendingCv.wait(l, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) return nullptr;
+            Request *req = pending.front();
+            pending.pop_front();
+            return req;
+        }
+
+        void PoolWorker() {
+            while (Request *req = PopPending()) {
+                req->done = readFunc(req->pos, req->slices);
+                Complete(req);
+            }
+        }
+
+#ifdef ABKNTFS_IO_URING
+        int ringFd = -1;
+        int fileFd = -1;
+        void *sqRing = MAP_FAILED;
+        void *cqRing = MAP_FAILED;
+        size_t sqRingSize = 0;
+        size_t cqRingSize = 0;
+        io_uring_sqe *sqes = (io_uring_sqe *)MAP_FAILED;
+        size_t sqesSize = 0;
+        unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+        unsigned *cqHead, *cqTail, *cqMask;
+        io_uring_cqe *cqes;
+        // ring 出错后由引擎线程启动的线程池线程, 引擎线程结束后才能访问.
+        std::vector<std::thread> fallbackThreads;
+
+        bool SetupUring(int fd) {
+            io_uring_params p = {};
+            ringFd = (int)syscall(__NR_io_uring_setup, queueDepth, &p);
+            if (ringFd < 0) return false;
+            sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+            if (single) {
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+            }
+            sqRing =
+                mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED) return false;
+            if (single) {
+                cqRing = sqRing;
+            }
+            else {
+                cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ringFd,
+                              IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED) return false;
+            }
+            sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+            sqes = (io_uring_sqe *)mmap(nullptr, sqesSize,
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_SHARED | MAP_POPULATE, ringFd,
+                                        IORING_OFF_SQES);
+            if (sqes == MAP_FAILED) return false;
+            char *sq = (char *)sqRing, *cq = (char *)cqRing;
+            sqHead = (unsigned *)(sq + p.sq_off.head);
+            sqTail = (unsigned *)(sq + p.sq_off.tail);
+            sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+            sqArray = (unsigned *)(sq + p.sq_off.array);
+            cqHead = (unsigned *)(cq + p.cq_off.head);
+            cqTail = (unsigned *)(cq + p.cq_off.tail);
+            cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+            cqes = (io_uring_cqe *)(cq + p.cq_off.cqes);
+            fileFd = fd;
+            return true;
+        }
+
+        void TeardownUring() {
+            if (sqes != MAP_FAILED) munmap(sqes, sqesSize);
+            if (cqRing != MAP_FAILED && cqRing != sqRing) {
+                munmap(cqRing, cqRingSize);
+            }
+            if (sqRing != MAP_FAILED) munmap(sqRing, sqRingSize);
+            if (ringFd >= 0) close(ringFd);
+            ringFd = -1;
+            sqes = (io_uring_sqe *)MAP_FAILED;
+            sqRing = cqRing = MAP_FAILED;
+        }
+
+        // 把请求中未读的部分放入提交队列, 只在引擎线程中调用.
+        void PrepareRead(Request *req) {
+            unsigned tail = *sqTail;
+            unsigned idx = tail & *sqMask;
+            io_uring_sqe &sqe = sqes[idx];
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = IORING_OP_READV;
+            sqe.fd = fileFd;
+            sqe.off = req->pos + req->done;
+            sqe.addr = (uint64_t)(uintptr_t)&req->iov[req->first];
+            sqe.len = (uint32_t)(req->iov.size() - req->first);
+            sqe.user_data = (uint64_t)(uintptr_t)req;
+            sqArray[idx] = idx;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        // 部分读取后跳过已读满的 iov. 返回是否还有未读的部分.
+        static bool Advance(Request *req, uint64_t rd) {
+            req->done += rd;
+            while (req->first < req->iov.size() &&
+                   rd >= req->iov[req->first].iov_len) {
+                rd -= req->iov[req->first].iov_len;
+                req->first++;
+            }
+            if (req->first == req->iov.size()) return false;
+            req->iov[req->first].iov_base =
+                (char *)req->iov[req->first].iov_base + rd;
+            req->iov[req->first].iov_len -= rd;
+            return true;
+        }
+
+        void UringWorker() {
+            uint32_t inflight = 0;
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    if (inflight == 0) {
+                        pendingCv.wait(l, [this] {
+                            return stopping || !pending.empty();
+                        });
+                        if (pending.empty()) return;
+                    }
+                    while (inflight < queueDepth && !pending.empty()) {
+                        Request *req = pending.front();
+                        pending.pop_front();
+                        req->iov.resize(req->slices.size());
+                        for (size_t i = 0; i < req->slices.size(); i++) {
+                            req->iov[i].iov_base = req->slices[i].buf;
+                            req->iov[i].iov_len = req->slices[i].len;
+                        }
+                        req->first = 0;
+                        PrepareRead(req);
+                        inflight++;
+                    }
+                }
+                unsigned toSubmit =
+                    *sqTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+                long ret = syscall(__NR_io_uring_enter, ringFd, toSubmit, 1,
+                                   IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (ret < 0 && errno != EINTR && errno != EAGAIN &&
+                    errno != EBUSY) {
+                    // ring 出错, 剩余请求改为同步读取
+                    break;
+                }
+                unsigned head = *cqHead;
+                while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                    io_uring_cqe &cqe = cqes[head & *cqMask];
+                    Request *req = (Request *)(uintptr_t)cqe.user_data;
+                    int res = cqe.res;
+                    head++;
+                    if (res == -EINTR || res == -EAGAIN ||
+                        (res > 0 && Advance(req, res))) {
+                        PrepareRead(req);
+                        continue;
+                    }
+                    inflight--;
+                    Complete(req);
+                }
+                __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            }
+            // ring 出错: 未提交的请求改为同步读取, 已提交的等待完成后
+            // 补齐, 之后的请求都交给线程池处理. 引擎线程自身也作为线程池
+            // 的一员, 共 queueDepth 个线程, 保持同时进行的读取数.
+            backend = BACKEND_THREAD_POOL;
+            for (uint32_t i = 1; i < queueDepth; i++) {
+                fallbackThreads.emplace_back(&AsyncReader::PoolWorker, this);
+            }
+            for (unsigned h = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+                 h != *sqTail; h++) {
+                inflight--;
+                FinishSync(
+                    (Request *)(uintptr_t)sqes[sqArray[h & *sqMask]].user_data);
+            }
+            while (inflight) {
+                unsigned head = *cqHead;
+                if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                    if (syscall(__NR_io_uring_enter, ringFd, 0, 1,
+                                IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                        errno != EINTR) {
+                        break;
+                    }
+                    continue;
+                }
+                io_uring_cqe &cqe = cqes[head & *cqMask];
+                Request *req = (Request *)(uintptr_t)cqe.user_data;
+                if (cqe.res > 0) Advance(req, cqe.res);
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                inflight--;
+                FinishSync(req);
+            }
+            PoolWorker();
+        }
+
+        // 同步读取请求剩余的部分
+        void FinishSync(Request *req) {
+            std::vector<IoSlice> rest;
+            for (size_t i = req->first; i < req->iov.size(); i++) {
+                rest.push_back({(char *)req->iov[i].iov_base,
+                                (uint64_t)req->iov[i].iov_len});
+            }
+            if (!rest.empty()) {
+                req->done += readFunc(req->pos + req->done, rest);
+            }
+            Complete(req);
+        }
+#endif
+    public:
+        // readFunc: 线程池使用的同步读取函数; fd: io_uring 读取的文件描述符,
+        // 小于 0 表示只使用线程池; queueDepth: 同时进行的读取数.
+        AsyncReader(ReadFunc readFunc, int fd = -1,
+                    uint32_t queueDepth = DefaultQueueDepth)
+            : readFunc(std::move(readFunc)),
+              queueDepth(queueDepth == 0               ? 1
+                         : queueDepth > MaxQueueDepth ? MaxQueueDepth
+                                                      : queueDepth) {
+#ifdef ABKNTFS_IO_URING
+            if (fd >= 0 && SetupUring(fd)) {
+                backend = BACKEND_IO_URING;
+                threads.emplace_back(&AsyncReader::UringWorker, this);
+                return;
+            }
+            TeardownUring();
+#endif
+            for (uint32_t i = 0; i < this->queueDepth; i++) {
+                threads.emplace_back(&AsyncReader::PoolWorker, this);
+            }
+        }
+
+        AsyncReader(AsyncReader const &r) = delete;
+        AsyncReader &operator=(AsyncReader const &r) = delete;
+
+        // 等待所有已提交的请求完成
+        ~AsyncReader() {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stopping = true;
+            }
+            pendingCv.notify_all();
+            for (auto &i : threads) {
+                i.join();
+            }
+#ifdef ABKNTFS_IO_URING
+            for (auto &i : fallbackThreads) {
+                i.join();
+            }
+            TeardownUring();
+#endif
+        }
+
+        // 从 pos 开始读取并依次填充 slices, 完成后调用 cb.
+        void Submit(uint64_t pos, std::vector<IoSlice> slices, Callback cb) {
+            Request *req = new Request();
+            req->pos = pos;
+            req->size = 0;
+            for (auto &i : slices) {
+                req->size += i.len;
+            }
+            req->done = 0;
+            req->slices = std::move(slices);
+            req->cb = std::move(cb);
+            req->start = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                pending.push_back(req);
+                outstanding++;
+            }
+            pendingCv.notify_one();
+        }
+
+        // 同上, 通过 future 返回实际读取的字节数.
+        std::future<uint64_t> Submit(uint64_t pos,
+                                     std::vector<IoSlice> slices) {
+            auto done = std::make_shared<std::promise<uint64_t>>();
+            std::future<uint64_t> ret = done->get_future();
+            Submit(pos, std::move(slices),
+                   [done](uint64_t rd) { done->set_value(rd); });
+            return ret;
+        }
+
+        // 等待当前所有已提交的请求完成
+        void Wait() {
+            std::unique_lock<std::mutex> l(lock);
+            idleCv.wait(l, [this] { return outstanding == 0; });
+        }
+
+        Backend GetBackend() const { return backend; }
+        uint32_t GetQueueDepth() const { return queueDepth; }
+        // 从提交到完成的延迟
+        LatencyHistogram::Snapshot GetLatency() const { return latency.Get(); }
+        void ResetLatency() { latency.Reset(); }
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+namespace abkntfs {
+    // 定长块的缓存, 按块号(比如 LCN) 索引, 分片加锁, 每个分片独立按 LRU 淘汰.
+    class BlockCache {
+    public:
+        struct Stats {
+            // 命中次数
+            uint64_t hits;
+            // 未命中次数
+            uint64_t misses;
+            // 因超出容量被淘汰的块数
+            uint64_t evictions;
+            // 当前缓存的数据大小 (单位: 字节)
+            uint64_t bytes;
+            // 容量 (单位: 字节)
+            uint64_t capacity;
+        };
+
+    private:
+        static const uint32_t ShardCount = 16;
+
+        struct Shard {
+            std::mutex lock;
+            // 最近使用的在前面
+            std::list<std::pair<uint64_t, std::vector<char>>> lru;
+            std::unordered_map<
+                uint64_t,
+                std::list<std::pair<uint64_t, std::vector<char>>>::iterator>
+                index;
+            uint64_t bytes = 0;
+        };
+
+        Shard shards[ShardCount];
+        uint64_t blockSize;
+        std::atomic<uint64_t> capacity;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> evictions{0};
+
+        Shard &GetShard(uint64_t blockId) {
+            return shards[(blockId * 0x9E3779B97F4A7C15ull) >> 60];
+        }
+
+        // 淘汰最久未使用的块直到满足分片容量, 需持有分片锁.
+        void Shrink(Shard &shard) {
+            uint64_t shardCapacity = capacity / ShardCount;
+            while (shard.bytes > shardCapacity && !shard.lru.empty()) {
+                shard.bytes -= shard.lru.back().second.size();
+                shard.index.erase(shard.lru.back().first);
+                shard.lru.pop_back();
+                evictions++;
+            }
+        }
+
+    public:
+        // blockSize: 块大小 (单位: 字节); capacity: 缓存容量 (单位: 字节),
+        // 为 0 表示不缓存.
+        BlockCache(uint64_t blockSize, uint64_t capacity)
+            : blockSize(blockSize), capacity(capacity) {}
+
+        BlockCache(BlockCache const &r) = delete;
+        BlockCache &operator=(BlockCache const &r) = delete;
+
+        uint64_t GetBlockSize() const { return blockSize; }
+
+        bool Enabled() const { return capacity >= blockSize * ShardCount; }
+
+        // 命中时把块数据拷贝到 dest (至少 blockSize 字节) 并返回 true.
+        bool Get(uint64_t blockId, char *dest) {
+            Shard &shard = GetShard(blockId);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.index.find(blockId);
+            if (it == shard.index.end()) {
+                misses++;
+                return false;
+            }
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            memcpy(dest, it->second->second.data(), blockSize);
+            hits++;
+            return true;
+        }
+
+        void Put(uint64_t blockId, char const *data) {
+            if (!Enabled()) return;
+            Shard &shard = GetShard(blockId);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.index.find(blockId);
+            if (it != shard.index.end()) {
+                memcpy(it->second->second.data(), data, blockSize);
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                return;
+            }
+            shard.lru.emplace_front(blockId,
+                                    std::vector<char>(data, data + blockSize));
+            shard.index[blockId] = shard.lru.begin();
+            shard.bytes += blockSize;
+            Shrink(shard);
+        }
+
+        // 块数据被改写后使其失效
+        void Invalidate(uint64_t blockId) {
+            Shard &shard = GetShard(blockId);
+            std::lock_guard<std::mutex> guard(shard.lock);
+            auto it = shard.index.find(blockId);
+            if (it == shard.index.end()) return;
+            shard.bytes -= blockSize;
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+
+        void Clear() {
+            for (auto &shard : shards) {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                shard.lru.clear();
+                shard.index.clear();
+                shard.bytes = 0;
+            }
+        }
+
+        // 修改容量, 超出的部分立即淘汰.
+        void SetCapacity(uint64_t bytes) {
+            capacity = bytes;
+            for (auto &shard : shards) {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                Shrink(shard);
+            }
+        }
+
+        Stats GetStats() {
+            Stats ret = {hits, misses, evictions, 0, capacity.load()};
+            for (auto &shard : shards) {
+                std::lock_guard<std::mutex> guard(shard.lock);
+                ret.bytes += shard.bytes;
+            }
+            return ret;
+        }
+    };
+}
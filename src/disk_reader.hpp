@@ -1,27 +1,90 @@
 #pragma once
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#include "async_reader.hpp"
+#include <algorithm>
+#include <memory>
 #include <stdexcept>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+#ifndef _WIN32
+// 非 MSVC 环境下没有 memcpy_s, 按 MSVC 的语义补充一个.
+inline int memcpy_s(void *dest, size_t destSize, void const *src,
+                    size_t count) {
+    if (count == 0) return 0;
+    if (dest == nullptr) return EINVAL;
+    if (src == nullptr || count > destSize) {
+        memset(dest, 0, destSize);
+        return src == nullptr ? EINVAL : ERANGE;
+    }
+    memcpy(dest, src, count);
+    return 0;
+}
+#endif
+
 namespace abkntfs {
     struct SuccessiveSectors {
         uint64_t startSecId;
         uint64_t secNum;
     };
 
+    // 批量读取请求: 把 [startSecId, startSecId + secNum) 扇区读到 dest.
+    struct SectorsRequest : SuccessiveSectors {
+        char *dest;
+
+        SectorsRequest(uint64_t start, uint64_t num, char *dest)
+            : SuccessiveSectors{start, num}, dest(dest) {}
+    };
+
+#ifdef _WIN32
     class DiskReader {
         const uint32_t MaxSectorSize = 4096;
         HANDLE fh = INVALID_HANDLE_VALUE;
         DWORD error = 0;
         DISK_SPACE_INFORMATION diskInfo;
-        char *sectorCache = nullptr;
 
     private:
-        struct SizeCompounds {
-            uint32_t l;
-            uint32_t h;
-        };
+        // 按位置读取 (ReadFile + OVERLAPPED), 不依赖也不修改共享的文件指针
+        // 语义, 多线程同时读取同一个对象是安全的.
+        bool ReadAt(uint64_t pos, char *buf, DWORD size, DWORD &rd) const {
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)pos;
+            ov.OffsetHigh = (DWORD)(pos >> 32);
+            return ReadFile(fh, buf, size, &rd, &ov);
+        }
+
+        // 从 pos 开始连续读取, 依次填充 slices. 返回实际读取的字节数.
+        uint64_t ReadVectored(uint64_t pos,
+                              std::vector<IoSlice> const &slices) const {
+            DWORD rd = 0;
+            uint64_t total = 0, done = 0;
+            for (auto &i : slices) {
+                total += i.len;
+            }
+            std::vector<char> t(total);
+            if (!ReadAt(pos, t.data(), (DWORD)total, rd)) {
+                return 0;
+            }
+            for (auto &i : slices) {
+                if (done + i.len > rd) break;
+                memcpy(i.buf, t.data() + done, i.len);
+                done += i.len;
+            }
+            return done;
+        }
 
     public:
         DiskReader() = default;
@@ -34,9 +97,9 @@ namespace abkntfs {
             fh = r.fh;
             error = r.error;
             diskInfo = r.diskInfo;
-            sectorCache = r.sectorCache;
+            asyncQueueDepth = r.asyncQueueDepth;
+            r.asyncReader.reset();
             r.fh = INVALID_HANDLE_VALUE;
-            r.sectorCache = nullptr;
         }
 
         DiskReader &operator=(DiskReader &&r) {
@@ -45,8 +108,8 @@ namespace abkntfs {
             return *this;
         }
 
-        DiskReader(std::string file) : diskInfo{0} {
-            sectorCache = nullptr;
+        // 卷设备无法进行内存映射, mapImage 在 Windows 下被忽略.
+        DiskReader(std::string file, bool mapImage = false) : diskInfo{0} {
             fh = CreateFileA(file.c_str(), GENERIC_READ | GENERIC_WRITE,
                              FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
                              OPEN_EXISTING, 0, NULL);
@@ -55,81 +118,79 @@ namespace abkntfs {
                 return;
             }
             GetDiskSpaceInformationA((file + "\\").c_str(), &diskInfo);
-            sectorCache = new char[diskInfo.BytesPerSector];
         }
 
         ~DiskReader() {
+            asyncReader.reset();
             if (fh != INVALID_HANDLE_VALUE) {
                 CloseHandle(fh);
             }
-            if (sectorCache) {
-                delete[] sectorCache;
-            }
             fh = INVALID_HANDLE_VALUE;
-            sectorCache = nullptr;
         }
         bool IsOpen() const { return fh != INVALID_HANDLE_VALUE; }
+        // Windows 下异步读取只使用线程池
+        int AsyncFd() const { return -1; }
+        bool IsMapped() const { return false; }
+        std::shared_ptr<char> MapSectors(uint64_t secId,
+                                         uint64_t secNum) const {
+            return nullptr;
+        }
         uint32_t GetSectorSize() const { return diskInfo.BytesPerSector; }
         uint64_t GetTotalSize() const {
             return diskInfo.ActualTotalAllocationUnits *
                    diskInfo.SectorsPerAllocationUnit * diskInfo.BytesPerSector;
         }
         std::vector<char> ReadSector(uint64_t secId) {
-            char *(&data) = sectorCache;
             DWORD rd;
             std::vector<char> ret;
-            SizeCompounds pos;
-            ((uint64_t &)pos) = (uint64_t)GetSectorSize() * secId;
             if (fh == INVALID_HANDLE_VALUE || diskInfo.BytesPerSector == 0) {
                 throw std::runtime_error("fail");
             }
-            SetFilePointer(fh, pos.l, (PLONG)&pos.h, FILE_BEGIN);
-            if (ReadFile(fh, data, diskInfo.BytesPerSector, &rd, NULL)) {
-                ret.resize(rd);
-                memcpy_s(ret.data(), rd, data, diskInfo.BytesPerSector);
+            ret.resize(diskInfo.BytesPerSector);
+            if (ReadAt((uint64_t)GetSectorSize() * secId, ret.data(),
+                       diskInfo.BytesPerSector, rd)) {
                 if (rd < diskInfo.BytesPerSector) {
                     throw std::runtime_error("fail");
                 }
                 return ret;
             }
+            ret.clear();
             return ret;
         }
         int32_t WriteSector(uint64_t secId, std::vector<char> data) {
-            DWORD wd;
+            DWORD wd = 0;
             DWORD stat;
-            SizeCompounds pos;
-            ((uint64_t &)pos) = (uint64_t)GetSectorSize() * secId;
+            uint64_t pos = (uint64_t)GetSectorSize() * secId;
+            OVERLAPPED ov = {};
+            ov.Offset = (DWORD)pos;
+            ov.OffsetHigh = (DWORD)(pos >> 32);
             if (data.size() < GetSectorSize()) {
                 data.resize(GetSectorSize());
             }
             if (fh == INVALID_HANDLE_VALUE || diskInfo.BytesPerSector == 0) {
                 return 0;
             }
-            SetFilePointer(fh, pos.l, (PLONG)&pos.h, FILE_BEGIN);
             // 锁定卷
             if (!DeviceIoControl(fh, FSCTL_LOCK_VOLUME, NULL, 0, NULL, 0, &stat,
                                  NULL)) {
                 return 0;
             }
-            WriteFile(fh, data.data(), GetSectorSize(), &wd, NULL);
+            WriteFile(fh, data.data(), GetSectorSize(), &wd, &ov);
             // 解锁
             DeviceIoControl(fh, FSCTL_UNLOCK_VOLUME, NULL, 0, NULL, 0, &stat,
                             NULL);
             return wd;
         }
         std::vector<char> ReadSectors(uint64_t secId, uint64_t secNum) {
-            char *(&data) = sectorCache;
             DWORD rd;
             std::vector<char> ret;
-            SizeCompounds pos;
-            ((uint64_t &)pos) = (uint64_t)GetSectorSize() * secId;
             if (fh == INVALID_HANDLE_VALUE || diskInfo.BytesPerSector == 0 ||
                 diskInfo.BytesPerSector > MaxSectorSize) {
                 throw std::runtime_error("fail");
             }
-            SetFilePointer(fh, pos.l, (PLONG)&pos.h, FILE_BEGIN);
             ret.resize(diskInfo.BytesPerSector * secNum);
-            if (ReadFile(fh, ret.data(), ret.size(), &rd, NULL)) {
+            if (ReadAt((uint64_t)GetSectorSize() * secId, ret.data(),
+                       (DWORD)ret.size(), rd)) {
                 if (rd < ret.size()) {
                     throw std::runtime_error("fail");
                 }
@@ -137,21 +198,340 @@ namespace abkntfs {
             }
             return ret;
         }
-        std::vector<char> ReadSectors(std::vector<SuccessiveSectors> &secs) {
-            std::vector<char> ret, t;
-            uint64_t pos;
-            try {
-                for (auto const &i : secs) {
-                    t = ReadSectors(i.startSecId, i.secNum);
-                    pos = ret.size();
-                    ret.resize(ret.size() + t.size());
-                    memcpy_s(&ret[pos], t.size(), t.data(), t.size());
+#else
+    // 基于 pread 的 POSIX 实现, 可打开原始镜像文件(.img/.dd) 或块设备
+    // (/dev/sdX).
+    class DiskReader {
+        const uint32_t MaxSectorSize = 4096;
+        int fd = -1;
+        int error = 0;
+        uint32_t bytesPerSector = 0;
+        uint64_t totalSize = 0;
+        // 内存映射模式下整个镜像的只读映射, 最后一个引用释放时解除映射.
+        std::shared_ptr<char> mapping;
+
+    private:
+        // 按位置读取, 不依赖共享的文件偏移, 多线程同时读取同一个对象是安全的.
+        // 返回实际读取的字节数.
+        uint64_t ReadAt(uint64_t pos, char *buf, uint64_t size) const {
+            uint64_t done = 0;
+            if (mapping) {
+                if (pos >= totalSize) return 0;
+                done = std::min(size, totalSize - pos);
+                memcpy(buf, mapping.get() + pos, done);
+                return done;
+            }
+            while (done < size) {
+                ssize_t rd = pread(fd, buf + done, size - done,
+                                   (off_t)(pos + done));
+                if (rd < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                if (rd == 0) break;
+                done += rd;
+            }
+            return done;
+        }
+
+        // 从 pos 开始连续读取, 依次填充 slices (preadv). 返回实际读取的字节数.
+        uint64_t ReadVectored(uint64_t pos,
+                              std::vector<IoSlice> const &slices) const {
+            uint64_t done = 0;
+            if (mapping) {
+                for (auto &i : slices) {
+                    uint64_t rd = ReadAt(pos + done, i.buf, i.len);
+                    done += rd;
+                    if (rd < i.len) break;
+                }
+                return done;
+            }
+            std::vector<iovec> iov(slices.size());
+            for (size_t i = 0; i < slices.size(); i++) {
+                iov[i].iov_base = slices[i].buf;
+                iov[i].iov_len = slices[i].len;
+            }
+            size_t first = 0;
+            while (first < iov.size()) {
+                ssize_t rd = preadv(fd, &iov[first], (int)(iov.size() - first),
+                                    (off_t)(pos + done));
+                if (rd < 0) {
+                    if (errno == EINTR) continue;
+                    break;
+                }
+                if (rd == 0) break;
+                done += rd;
+                // 跳过已读满的缓冲区, 部分读取的从剩余位置继续.
+                while (first < iov.size() && (size_t)rd >= iov[first].iov_len) {
+                    rd -= iov[first].iov_len;
+                    first++;
+                }
+                if (first < iov.size()) {
+                    iov[first].iov_base = (char *)iov[first].iov_base + rd;
+                    iov[first].iov_len -= rd;
                 }
             }
-            catch (std::exception &e) {
-                throw e;
+            return done;
+        }
+
+        // 扇区大小优先取 $Boot 中的 bytesPerSector, 其次是块设备的逻辑扇区
+        // 大小 (BLKSSZGET), 都没有则为 512.
+        uint32_t ProbeSectorSize(bool isBlockDevice) const {
+            uint16_t bootBytesPerSector = 0;
+            char boot[512];
+            // bytesPerSector 在 $Boot 中的偏移为 0x0B
+            if (ReadAt(0, boot, sizeof(boot)) == sizeof(boot)) {
+                memcpy(&bootBytesPerSector, &boot[0x0B],
+                       sizeof(bootBytesPerSector));
+            }
+            if (bootBytesPerSector >= 512 &&
+                bootBytesPerSector <= MaxSectorSize &&
+                !(bootBytesPerSector & (bootBytesPerSector - 1))) {
+                return bootBytesPerSector;
+            }
+            int blockSize = 0;
+            if (isBlockDevice && ioctl(fd, BLKSSZGET, &blockSize) == 0 &&
+                blockSize > 0) {
+                return (uint32_t)blockSize;
+            }
+            return 512;
+        }
+
+    public:
+        DiskReader() = default;
+
+        DiskReader(DiskReader const &r) = delete;
+
+        DiskReader &operator=(DiskReader const &r) = delete;
+
+        DiskReader(DiskReader &&r) {
+            fd = r.fd;
+            error = r.error;
+            bytesPerSector = r.bytesPerSector;
+            totalSize = r.totalSize;
+            mapping = std::move(r.mapping);
+            asyncQueueDepth = r.asyncQueueDepth;
+            r.asyncReader.reset();
+            r.fd = -1;
+        }
+
+        DiskReader &operator=(DiskReader &&r) {
+            this->~DiskReader();
+            new (this) DiskReader(std::move(r));
+            return *this;
+        }
+
+        // mapImage 为 true 时把整个镜像映射到内存, 之后的读取直接从映射中
+        // 拷贝, 也可以通过 MapSectors() 获得不拷贝的视图.
+        DiskReader(std::string file, bool mapImage = false) {
+            fd = open(file.c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0) {
+                // 只读的镜像文件
+                fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            }
+            if (fd < 0) {
+                error = errno;
+                return;
+            }
+            struct stat st = {};
+            fstat(fd, &st);
+            bool isBlockDevice = S_ISBLK(st.st_mode);
+            if (isBlockDevice) {
+                ioctl(fd, BLKGETSIZE64, &totalSize);
+            }
+            else {
+                totalSize = st.st_size;
+            }
+            bytesPerSector = ProbeSectorSize(isBlockDevice);
+            if (mapImage && totalSize) {
+                void *p =
+                    mmap(nullptr, totalSize, PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED) {
+                    uint64_t size = totalSize;
+                    mapping = std::shared_ptr<char>(
+                        (char *)p, [size](char *q) { munmap(q, size); });
+                }
+            }
+        }
+
+        ~DiskReader() {
+            asyncReader.reset();
+            if (fd >= 0) {
+                close(fd);
+            }
+            fd = -1;
+        }
+        bool IsOpen() const { return fd >= 0; }
+        // io_uring 读取使用的文件描述符
+        int AsyncFd() const { return fd; }
+        bool IsMapped() const { return (bool)mapping; }
+        // 内存映射模式下返回指向 [secId, secId + secNum) 扇区的视图
+        // (共享映射的所有权), 非映射模式或越界时返回空指针.
+        std::shared_ptr<char> MapSectors(uint64_t secId,
+                                         uint64_t secNum) const {
+            uint64_t pos = (uint64_t)bytesPerSector * secId;
+            uint64_t size = (uint64_t)bytesPerSector * secNum;
+            if (!mapping || pos > totalSize || size > totalSize - pos) {
+                return nullptr;
+            }
+            return std::shared_ptr<char>(mapping, mapping.get() + pos);
+        }
+        uint32_t GetSectorSize() const { return bytesPerSector; }
+        uint64_t GetTotalSize() const { return totalSize; }
+        std::vector<char> ReadSector(uint64_t secId) {
+            return ReadSectors(secId, 1);
+        }
+        int32_t WriteSector(uint64_t secId, std::vector<char> data) {
+            if (data.size() < GetSectorSize()) {
+                data.resize(GetSectorSize());
+            }
+            if (fd < 0 || bytesPerSector == 0) {
+                return 0;
+            }
+            ssize_t wd = pwrite(fd, data.data(), GetSectorSize(),
+                                (off_t)((uint64_t)GetSectorSize() * secId));
+            return wd < 0 ? 0 : (int32_t)wd;
+        }
+        std::vector<char> ReadSectors(uint64_t secId, uint64_t secNum) {
+            std::vector<char> ret;
+            if (fd < 0 || bytesPerSector == 0 ||
+                bytesPerSector > MaxSectorSize) {
+                throw std::runtime_error("fail");
+            }
+            ret.resize(bytesPerSector * secNum);
+            if (ReadAt((uint64_t)GetSectorSize() * secId, ret.data(),
+                       ret.size()) < ret.size()) {
+                throw std::runtime_error("fail");
+            }
+            return ret;
+        }
+#endif
+    private:
+        // 异步读取引擎的队列深度, 0 表示 ReadBatch 串行读取.
+        uint32_t asyncQueueDepth = 0;
+        std::mutex asyncLock;
+        // 首次使用时创建. 读取函数绑定了 this, 移动时不转移.
+        std::shared_ptr<AsyncReader> asyncReader;
+
+    public:
+        // 设置异步读取的队列深度, 0 表示关闭. SSD 适合较大的值, 机械硬盘
+        // 适合较小的值.
+        void SetAsyncQueueDepth(uint32_t depth) {
+            std::lock_guard<std::mutex> guard(asyncLock);
+            asyncReader.reset();
+            asyncQueueDepth = depth;
+        }
+
+        uint32_t GetAsyncQueueDepth() const { return asyncQueueDepth; }
+
+        // 返回异步读取引擎, 未启用时返回空指针. 调用者可以直接向其提交
+        // 请求, ReadBatch 也通过它并发读取合并后的各段.
+        std::shared_ptr<AsyncReader> GetAsyncReader() {
+            std::lock_guard<std::mutex> guard(asyncLock);
+            if (!asyncReader && asyncQueueDepth && IsOpen()) {
+                asyncReader = std::make_shared<AsyncReader>(
+                    [this](uint64_t pos, std::vector<IoSlice> const &slices) {
+                        return ReadVectored(pos, slices);
+                    },
+                    IsMapped() ? -1 : AsyncFd(), asyncQueueDepth);
+            }
+            return asyncReader;
+        }
+
+        // 合并读取时允许的最大间隙 (单位: 扇区), 间隙的数据读取后丢弃.
+        static const uint64_t DefaultMaxGapSectors = 128;
+        // 单次向量读取最多的缓冲区数 (IOV_MAX)
+        static const size_t MaxIoSlices = 1024;
+
+        // 批量读取. 请求按物理位置排序, 相邻或间隔不超过 maxGapSecs
+        // 的请求合并为一次向量读取, 直接读入各自的 dest.
+        // 读取失败抛出异常.
+        void ReadBatch(std::vector<SectorsRequest> reqs,
+                       uint64_t maxGapSecs = DefaultMaxGapSectors) {
+            uint64_t secSize = GetSectorSize();
+            if (!IsOpen() || secSize == 0 || secSize > MaxSectorSize) {
+                throw std::runtime_error("fail");
+            }
+            std::sort(reqs.begin(), reqs.end(),
+                      [](SectorsRequest const &a, SectorsRequest const &b) {
+                          return a.startSecId < b.startSecId;
+                      });
+            // 所有间隙共用一个丢弃缓冲区 (并发读取时内容无意义, 只是被覆盖)
+            std::vector<char> gap;
+            std::vector<IoSlice> slices;
+            uint64_t groupBeg = 0, groupEnd = 0;
+            // 合并后的各段: 起始扇区, 扇区数, 缓冲区
+            std::vector<SuccessiveSectors> groups;
+            std::vector<std::vector<IoSlice>> groupSlices;
+            auto flush = [&]() {
+                if (slices.empty()) return;
+                groups.push_back({groupBeg, groupEnd - groupBeg});
+                groupSlices.push_back(std::move(slices));
+                slices.clear();
+            };
+            for (auto const &i : reqs) {
+                if (i.secNum == 0) continue;
+                // 重叠的请求不能放进同一次读取
+                bool merge = !slices.empty() && i.startSecId >= groupEnd &&
+                             i.startSecId - groupEnd <= maxGapSecs &&
+                             slices.size() + 2 <= MaxIoSlices;
+                if (!merge) {
+                    flush();
+                    groupBeg = groupEnd = i.startSecId;
+                }
+                else if (i.startSecId > groupEnd) {
+                    if (gap.empty()) gap.resize(maxGapSecs * secSize);
+                    slices.push_back(
+                        {gap.data(), (i.startSecId - groupEnd) * secSize});
+                }
+                slices.push_back({i.dest, i.secNum * secSize});
+                groupEnd = i.startSecId + i.secNum;
+            }
+            flush();
+            std::shared_ptr<AsyncReader> async;
+            if (groups.size() > 1 && !IsMapped()) {
+                async = GetAsyncReader();
+            }
+            bool ok = true;
+            if (async) {
+                std::vector<std::future<uint64_t>> done;
+                for (size_t i = 0; i < groups.size(); i++) {
+                    done.push_back(async->Submit(
+                        groups[i].startSecId * secSize, groupSlices[i]));
+                }
+                // 失败时也要等所有请求结束, 之后缓冲区才能释放.
+                for (size_t i = 0; i < groups.size(); i++) {
+                    ok = done[i].get() >= groups[i].secNum * secSize && ok;
+                }
+            }
+            else {
+                for (size_t i = 0; i < groups.size() && ok; i++) {
+                    ok = ReadVectored(groups[i].startSecId * secSize,
+                                      groupSlices[i]) >=
+                         groups[i].secNum * secSize;
+                }
+            }
+            if (!ok) {
+                throw std::runtime_error("fail");
+            }
+        }
+
+        std::vector<char> ReadSectors(std::vector<SuccessiveSectors> &secs) {
+            std::vector<char> ret;
+            std::vector<SectorsRequest> reqs;
+            uint64_t pos = 0;
+            // 一次分配好全部输出
+            for (auto const &i : secs) {
+                pos += i.secNum * GetSectorSize();
+            }
+            ret.resize(pos);
+            pos = 0;
+            for (auto const &i : secs) {
+                reqs.emplace_back(i.startSecId, i.secNum, &ret[0] + pos);
+                pos += i.secNum * GetSectorSize();
             }
+            ReadBatch(reqs);
             return ret;
         }
     };
-}
\ No newline at end of file
+}
@@ -1,19 +1,32 @@
+#ifdef _WIN32
 #include "find_devices.hpp"
+#endif
 #include "my_utilities.hpp"
 #include "ntfs_access.hpp"
+#include "ntfs_app_MftScanner.hpp"
+#include "ntfs_app_PathTable.hpp"
+#include "ntfs_app_TreeWalker.hpp"
+#include "ntfs_app_UsnColumns.hpp"
+#include "ntfs_app_UsnFollower.hpp"
 #include "ntfs_app_UsnJrnl.hpp"
+#include "ntfs_app_UsnPathResolver.hpp"
 #include <chrono>
 #include <codecvt>
+#include <cstdlib>
 #include <ctime>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <locale>
 #include <ratio>
 #include <sstream>
 #include <string>
+#include <unordered_set>
 
+#ifdef _WIN32
 // 加载卷
-abkntfs::Ntfs LoadVolume() {
+abkntfs::Ntfs LoadVolume(int argc, char *argv[]) {
     abkntfs::Devices devs;
     int vol_i = 0;
     // 展示设备
@@ -50,6 +63,36 @@ abkntfs::Ntfs LoadVolume() {
 
     return abkntfs::Ntfs{volumePath};
 }
+#else
+// 加载镜像文件(.img/.dd) 或块设备(/dev/sdX), 路径可由命令行参数指定.
+// 参数 --mmap 表示以内存映射方式打开镜像文件; --qd N 表示以队列深度 N
+// 异步读取.
+abkntfs::Ntfs LoadVolume(int argc, char *argv[]) {
+    std::string volumePath;
+    bool mapImage = false;
+    uint32_t queueDepth = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--mmap") {
+            mapImage = true;
+        }
+        else if (arg == "--qd" && i + 1 < argc) {
+            queueDepth = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else {
+            volumePath = arg;
+        }
+    }
+    if (volumePath.empty()) {
+        std::cout << "输入镜像文件或块设备的路径: ";
+        std::getline(std::cin, volumePath);
+        volumePath = trim(volumePath);
+    }
+    abkntfs::Ntfs disk{volumePath, mapImage};
+    disk.SetAsyncQueueDepth(queueDepth);
+    return disk;
+}
+#endif
 
 void ShowSecsInfo(abkntfs::NtfsSectorsInfo secs) {
     for (auto &i : secs) {
@@ -81,6 +124,245 @@ void ShowVolumeInfo(abkntfs::Ntfs &disk) {
     ShowSecsInfo(secs);
 }
 
+// 显示块缓存统计
+void ShowBlockCacheStats(abkntfs::Ntfs &disk) {
+    abkntfs::BlockCache::Stats stats = disk.GetBlockCacheStats();
+    uint64_t total = stats.hits + stats.misses;
+    std::cout << "块缓存:" << std::endl;
+    std::cout << "  容量: " << FriendlyFileSize(stats.capacity) << std::endl;
+    std::cout << "  已用: " << FriendlyFileSize(stats.bytes) << std::endl;
+    std::cout << "  命中: " << std::dec << stats.hits << std::endl;
+    std::cout << "  未命中: " << std::dec << stats.misses << std::endl;
+    std::cout << "  淘汰: " << std::dec << stats.evictions << std::endl;
+    std::cout << "  命中率: " << std::fixed << std::setprecision(2)
+              << (total ? 100.0 * stats.hits / total : 0.0) << "%"
+              << std::endl;
+}
+
+void ShowAsyncReaderStats(abkntfs::Ntfs &disk) {
+    std::shared_ptr<abkntfs::AsyncReader> async = disk.GetAsyncReader();
+    std::cout << "异步读取:" << std::endl;
+    if (!async) {
+        std::cout << "  未启用" << std::endl;
+        return;
+    }
+    abkntfs::LatencyHistogram::Snapshot lat = async->GetLatency();
+    std::cout << "  后端: "
+              << (async->GetBackend() == abkntfs::AsyncReader::BACKEND_IO_URING
+                      ? "io_uring"
+                      : "线程池")
+              << std::endl;
+    std::cout << "  队列深度: " << std::dec << async->GetQueueDepth()
+              << std::endl;
+    std::cout << "  请求数: " << lat.count << std::endl;
+    if (!lat.count) return;
+    std::cout << "  平均延迟: " << lat.totalUs / lat.count << " us" << std::endl;
+    std::cout << "  最大延迟: " << lat.maxUs << " us" << std::endl;
+    std::cout << "  P50/P99: < " << lat.Percentile(50) << " us / < "
+              << lat.Percentile(99) << " us" << std::endl;
+    for (uint32_t i = 0; i < abkntfs::LatencyHistogram::BucketCount; i++) {
+        if (!lat.buckets[i]) continue;
+        std::cout << "  < " << std::setw(10) << (2ull << i)
+                  << " us: " << lat.buckets[i] << std::endl;
+    }
+}
+
+// 扫描整个 MFT 并打印统计. threads 为 0 时单线程顺序扫描, 否则使用并行
+// 流水线, ordered 表示是否按文件记录号顺序交付, includeFree 表示是否包含
+// 未使用的文件记录.
+void ScanMft(abkntfs::Ntfs &disk, uint64_t startFRN, uint32_t threads,
+             bool ordered, bool includeFree) {
+    abkntfs::NtfsMftScanner scanner{
+        disk, abkntfs::NtfsMftScanner::DefaultChunkSize, includeFree};
+    if (!scanner.valid) {
+        std::cout << "无法读取 $MFT." << std::endl;
+        return;
+    }
+    uint64_t inUse = 0, dirs = 0;
+    auto callback = [&](abkntfs::NtfsFileRecord &record) {
+        uint16_t flags = record.fixedFields.flags;
+        if (flags & abkntfs::NtfsFileRecord::FILE_RECORD_IN_USE) {
+            inUse++;
+            if (flags & abkntfs::NtfsFileRecord::FILE_RECORD_IS_DIRECTORY) {
+                dirs++;
+            }
+        }
+        return true;
+    };
+    abkntfs::NtfsMftScanner::ScanStats stats;
+    if (threads) {
+        stats = scanner.ParallelForEachFileRecord(callback, threads, ordered,
+                                                  startFRN);
+    }
+    else {
+        uint64_t records = 0;
+        auto beg = std::chrono::steady_clock::now();
+        stats.nextFRN = scanner.ForEachFileRecord(
+            [&](abkntfs::NtfsFileRecord &record) {
+                records++;
+                return callback(record);
+            },
+            startFRN);
+        stats.records = records;
+        stats.bytes = scanner.GetBytesRead();
+        stats.seconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - beg)
+                            .count();
+    }
+    std::cout << "MFT 扫描:" << std::endl;
+    std::cout << "  文件记录: " << std::dec << startFRN << " ~ "
+              << stats.nextFRN << std::endl;
+    std::cout << "  有效: " << stats.records << std::endl;
+    std::cout << "  使用中: " << inUse << std::endl;
+    std::cout << "  目录: " << dirs << std::endl;
+    std::cout << "  耗时: " << std::fixed << std::setprecision(3)
+              << stats.seconds << " s" << std::endl;
+    std::cout << "  读取: " << FriendlyFileSize(stats.bytes) << std::endl;
+    std::cout << "  速度: " << std::setprecision(0)
+              << stats.RecordsPerSecond() << " 条/s, " << std::setprecision(2)
+              << stats.MBPerSecond() << " MB/s" << std::endl;
+    if (stats.nextFRN < disk.FileRecordsCount) {
+        std::cout << "  读取文件记录 " << stats.nextFRN << " 失败." << std::endl;
+    }
+}
+
+// 路径表命令的参数
+struct PathTableParams {
+    // 并行解析的线程数
+    uint32_t threads = 0;
+    // 打印所有路径
+    bool list = false;
+    // 从文件加载而不扫描 MFT
+    std::string load;
+    // 建立后保存到文件
+    std::string save;
+    // 列出此目录 (文件记录号) 的内容, (uint64_t)-1 表示不列出
+    uint64_t ls = (uint64_t)-1;
+    // 递归列出此目录下的所有文件
+    uint64_t tree = (uint64_t)-1;
+    // 在 ls 指定的目录 (默认为根目录) 中查找此文件名
+    std::string find;
+};
+
+// 扫描 MFT (或从文件加载) 建立整个卷的路径表并打印统计, 之后按参数打印路径
+// 或列出目录.
+void ShowPathTable(abkntfs::Ntfs &disk, PathTableParams const &params) {
+    auto beg = std::chrono::steady_clock::now();
+    abkntfs::NtfsPathTable table =
+        params.load.empty() ? abkntfs::NtfsPathTable{disk, params.threads}
+                            : abkntfs::NtfsPathTable{params.load, disk};
+    double buildSeconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - beg)
+                              .count();
+    if (!table.valid) {
+        std::cout << (params.load.empty() ? "建立路径表失败."
+                                          : "加载路径表失败.")
+                  << std::endl;
+        return;
+    }
+    if (!params.save.empty() && !table.Save(params.save)) {
+        std::cout << "保存路径表失败." << std::endl;
+    }
+    if (!params.find.empty()) {
+        uint64_t dir = params.ls != (uint64_t)-1
+                           ? params.ls
+                           : (uint64_t)abkntfs::NtfsPathTable::RootFRN;
+        uint64_t FRN = table.FindChild(dir, str2wstr(params.find));
+        if (FRN == abkntfs::NtfsPathTable::NoEntry) {
+            std::cout << "  未找到 \"" << params.find << "\"" << std::endl;
+            return;
+        }
+        std::cout << "  " << wstr2str(table.GetPath(FRN))
+                  << "  文件记录号: " << std::dec << FRN << std::endl;
+        return;
+    }
+    if (params.ls != (uint64_t)-1) {
+        std::cout << "目录 " << wstr2str(table.GetPath(params.ls)) << " 下有 "
+                  << std::dec << table.GetChildrenCount(params.ls)
+                  << " 项:" << std::endl;
+        uint64_t number = 1;
+        table.ForEachChild(params.ls, [&](uint64_t FRN) {
+            std::cout << std::left << std::setfill(' ') << std::setw(8)
+                      << "  [" + std::to_string(number++) + "]";
+            std::cout << std::left << std::setfill(' ') << std::setw(40)
+                      << "  文件名: \"" + wstr2str(table.GetName(FRN)) + "\"";
+            std::cout << "  文件记录号: " << std::dec << FRN << std::endl;
+            return true;
+        });
+        return;
+    }
+    if (params.tree != (uint64_t)-1) {
+        std::cout << wstr2str(table.GetPath(params.tree)) << std::endl;
+        table.ForEachDescendant(params.tree, [&](uint64_t FRN, uint32_t depth) {
+            std::cout << ssp{depth * 2} << wstr2str(table.GetName(FRN))
+                      << " (" << std::dec << FRN << ")" << std::endl;
+            return true;
+        });
+        return;
+    }
+    uint64_t count = 0, chars = 0;
+    beg = std::chrono::steady_clock::now();
+    table.ForEachPath([&](uint64_t FRN, std::wstring const &path) {
+        count++;
+        chars += path.size();
+        if (params.list) {
+            std::cout << std::dec << FRN << "\t" << wstr2str(path) << std::endl;
+        }
+        return true;
+    });
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - beg)
+                         .count();
+    abkntfs::NtfsPathTable::BuildStats const &stats = table.GetBuildStats();
+    uint64_t memory = table.GetMemoryUsage();
+    std::cout << "路径表:" << std::endl;
+    std::cout << "  文件: " << std::dec << stats.entries << std::endl;
+    std::cout << "  不同的文件名: " << stats.names << std::endl;
+    std::cout << "  内存: " << FriendlyFileSize(memory) << ", 每百万条 "
+              << FriendlyFileSize(stats.entries
+                                      ? memory * 1000000 / stats.entries
+                                      : 0)
+              << std::endl;
+    std::cout << "  " << (params.load.empty() ? "扫描" : "加载")
+              << "耗时: " << std::fixed << std::setprecision(3)
+              << buildSeconds << " s" << std::endl;
+    std::cout << "  计算路径耗时: " << seconds << " s" << std::endl;
+    std::cout << "  路径: " << count << " 条, 共 " << chars << " 个字符"
+              << std::endl;
+}
+
+// 从目录 FRN 开始并行递归遍历, 打印统计; list 为 true 时打印每个文件的路径.
+void WalkTree(abkntfs::Ntfs &disk, uint64_t FRN,
+              abkntfs::NtfsTreeWalker::Options const &options, bool list) {
+    abkntfs::NtfsTreeWalker walker{disk};
+    if (!walker.valid) {
+        std::cout << "无法遍历." << std::endl;
+        return;
+    }
+    uint64_t dirs = 0;
+    auto stats = walker.Walk(
+        FRN,
+        [&](abkntfs::NtfsTreeWalker::Entry const &entry,
+            std::wstring const &dirPath) {
+            dirs += entry.IsDirectory();
+            if (list) {
+                std::cout << std::dec << entry.FRN << "\t"
+                          << wstr2str(dirPath + entry.name) << std::endl;
+            }
+            return true;
+        },
+        options);
+    std::cout << "目录遍历:" << std::endl;
+    std::cout << "  文件: " << std::dec << stats.entries << " (其中目录 "
+              << dirs << ")" << std::endl;
+    std::cout << "  展开的目录: " << stats.dirs << std::endl;
+    std::cout << "  跳过的重解析点: " << stats.reparse << std::endl;
+    std::cout << "  重复的目录: " << stats.revisits << std::endl;
+    std::cout << "  读取失败: " << stats.errors << std::endl;
+    std::cout << "  耗时: " << std::fixed << std::setprecision(3)
+              << stats.seconds << " s" << std::endl;
+}
+
 void ShowStandardInfo(abkntfs::AttrData_STANDARD_INFOMATION &info,
                       uint32_t preSpace = 0) {
     if (!info.valid) {
@@ -262,16 +544,16 @@ void ShowIndexAlloc(abkntfs::AttrData_INDEX_ALLOCATION &info,
         return;
     }
     std::cout << ssp{preSpace} << "所有索引记录: " << std::endl;
-    for (int i = 0; i < info.GetIRs().size(); i++) {
-        abkntfs::NtfsIndexRecord &IR = info.GetIRs()[i];
+    for (uint64_t i = 0; i < info.GetIRsCount(); i++) {
+        std::shared_ptr<abkntfs::NtfsIndexRecord> pIR = info.GetIR(i);
         std::cout << ssp{preSpace + 2} << "索引记录 [" << std::dec << i << "]";
-        if (!IR.valid) {
+        if (!pIR || !pIR->valid) {
             std::cout << "\t无效索引记录!!!" << std::endl;
             continue;
         }
         std::cout << ssp{preSpace + 2} << "是否为叶子节点: " << std::boolalpha
-                  << !IR.node.nodeHeader.notLeafNode << std::endl;
-        ShowIndexEntries(IR.node.IEs, preSpace + 4);
+                  << !pIR->node.nodeHeader.notLeafNode << std::endl;
+        ShowIndexEntries(pIR->node.IEs, preSpace + 4);
     }
 }
 
@@ -403,17 +685,14 @@ void ShowDirFiles(abkntfs::NtfsFileRecord rcd) {
         std::cout << std::endl;
         std::cout << "文件夹内容:" << std::endl;
         uint64_t number = 1;
-        auto showFile =
-            [&](abkntfs::NtfsFileNameIndex::FileInfoInIndex info) -> bool {
+        for (auto const &entry : index) {
             std::cout << std::left << std::setfill(' ') << std::setw(8)
                       << "  [" + std::to_string(number++) + "]";
             std::cout << std::left << std::setfill(' ') << std::setw(40)
-                      << "  文件名: \"" + wstr2str(info.fn.filename) + "\"";
+                      << "  文件名: \"" + wstr2str(entry.GetFileName()) + "\"";
             std::cout << "  文件记录号: " << std::dec << std::left
-                      << info.fileRef.fileRecordNum << std::endl;
-            return true;
-        };
-        index.ForEachFileInfo(showFile);
+                      << entry.GetFileRef().fileRecordNum << std::endl;
+        }
     }
     else {
         std::cout << "此非文件夹!" << std::endl;
@@ -421,6 +700,462 @@ void ShowDirFiles(abkntfs::NtfsFileRecord rcd) {
     std::cout << std::endl;
 }
 
+// 在目录的 $I30 索引中查找文件名
+void FindDirFile(abkntfs::NtfsFileRecord rcd, std::string const &name) {
+    abkntfs::NtfsFileNameIndex index = rcd;
+    if (!index.valid) {
+        std::cout << "此非文件夹!" << std::endl;
+        return;
+    }
+    auto info = index.FindFile(str2wstr(name));
+    if (!info.valid) {
+        std::cout << "  未找到 \"" << name << "\"" << std::endl;
+        return;
+    }
+    std::cout << "  文件名: \"" << wstr2str(info.fn.filename) << "\"";
+    std::cout << "  文件记录号: " << std::dec << info.fileRef.fileRecordNum
+              << std::endl;
+}
+
+// 遍历目录并对其中的每个文件名用 FindFile 查找, 各 rounds 轮, 打印平均
+// 每项的耗时.
+void BenchDirFind(abkntfs::NtfsFileRecord rcd, uint64_t rounds) {
+    abkntfs::NtfsFileNameIndex index = rcd;
+    if (!index.valid) {
+        std::cout << "此非文件夹!" << std::endl;
+        return;
+    }
+    std::vector<std::wstring> names;
+    for (auto const &entry : index) {
+        names.push_back(entry.GetFileName());
+    }
+    if (names.empty()) {
+        std::cout << "  目录为空." << std::endl;
+        return;
+    }
+    uint64_t visited = 0;
+    auto beg = std::chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (auto it = index.begin(); it != index.end(); ++it) {
+            visited++;
+        }
+    }
+    double walkSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - beg)
+                             .count();
+    uint64_t missed = 0;
+    beg = std::chrono::steady_clock::now();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (auto &name : names) {
+            if (!index.FindFile(name).valid) missed++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - beg)
+                         .count();
+    uint64_t lookups = rounds * names.size();
+    std::cout << "  索引项数: " << std::dec << names.size() << std::endl;
+    std::cout << "  遍历平均耗时: " << std::fixed << std::setprecision(2)
+              << walkSeconds * 1e9 / visited << " ns/项"
+              << std::endl;
+    std::cout << "  查找次数: " << lookups << "  未找到: " << missed
+              << std::endl;
+    std::cout << "  查找平均耗时: " << seconds * 1e9 / lookups << " ns"
+              << std::endl;
+}
+
+// p logj 的参数
+struct UsnJrnlParams {
+    // 打印的条数, 0 表示不限
+    uint64_t count = 10;
+    // 从第一个 USN 不小于此值的条目开始正向打印, (uint64_t)-1 表示不指定
+    uint64_t usn = (uint64_t)-1;
+    // 从第一个时间不早于此值的条目开始正向打印, 0 表示不指定
+    uint64_t since = 0;
+    // 正向打印时遇到时间不早于此值的条目停止, 0 表示不限
+    uint64_t until = 0;
+    // 只打印匹配的日志
+    abkntfs::NtfsUsnJrnl::Filter filter;
+    // 持续打印新增的日志
+    bool follow = false;
+    // 跟踪时保存检查点的状态文件, 为空则不保存
+    std::string stateFile;
+    // 跟踪时的轮询间隔 (单位: 毫秒)
+    uint64_t interval = 1000;
+};
+
+// 解析逗号分隔的原因名称或数值 (可用 0x 前缀), 失败返回 false.
+bool ParseUsnReasons(std::string const &text, uint32_t &mask) {
+    using J = abkntfs::NtfsUsnJrnl;
+    static const std::pair<char const *, uint32_t> names[] = {
+        {"create", J::FILE_OR_DIRECTORY_WAS_CREATED},
+        {"delete", J::FILE_OR_DIRECTORY_WAS_DELETED},
+        {"rename",
+         J::FILE_OR_DIRECTORY_RENAMED_OLD | J::FILE_OR_DIRECTORY_RENAMED_NEW},
+        {"renameold", J::FILE_OR_DIRECTORY_RENAMED_OLD},
+        {"renamenew", J::FILE_OR_DIRECTORY_RENAMED_NEW},
+        {"data", J::UNNAMED_DATA_STREAM_WAS_OVERWRITTEN |
+                     J::UNNAMED_DATA_STREAM_WAS_ADDED |
+                     J::UNNAMED_DATA_STREAM_WAS_TRUNCATED},
+        {"stream", J::NAMED_DATA_STREAM_WAS_OVERWRITTEN |
+                       J::NAMED_DATA_STREAM_WAS_ADDED |
+                       J::NAMED_DATA_STREAM_WAS_TRUNCATED |
+                       J::FILE_NAMED_STREAM_CHANGED},
+        {"attr", J::FILE_ATTR_CHANGED},
+        {"security", J::ACCESS_RIGHTS_CHANGED},
+        {"hardlink", J::FILE_HARD_LINK_CHANGED},
+        {"compress", J::FILE_COMPRESSED_CHANGED},
+        {"encrypt", J::FILE_ENCRYPTED_OR_DECRYPTED},
+        {"objid", J::FILE_OBJID_CHANGED},
+        {"reparse", J::REPARSE_POINT_CHANGED},
+        {"close", J::FILE_CLOSED},
+    };
+    mask = 0;
+    std::stringstream ss{text};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        bool found = false;
+        for (auto const &i : names) {
+            if (compareStrNoCase(item, i.first)) {
+                mask |= i.second;
+                found = true;
+            }
+        }
+        if (found) continue;
+        try {
+            size_t used = 0;
+            mask |= (uint32_t)std::stoul(item, &used, 0);
+            if (used != item.size()) return false;
+        }
+        catch (...) {
+            return false;
+        }
+    }
+    return mask != 0;
+}
+
+// 解析逗号分隔的文件记录号
+std::unordered_set<uint64_t> ParseFRNList(std::string const &text) {
+    std::unordered_set<uint64_t> ret;
+    std::stringstream ss{text};
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            ret.insert(std::stoull(item));
+        }
+        catch (...) {
+        }
+    }
+    return ret;
+}
+
+// 打印一批 $J 日志 (按 USN 递增顺序), 所在目录由 paths 按日志中的父目录
+// 引用解析.
+void ShowUsnEntries(abkntfs::NtfsUsnPathResolver &paths,
+                    std::vector<abkntfs::NtfsUsnJrnl::JEntry> const &logRecs) {
+    for (auto const &i : logRecs) {
+        std::cout << "[USN " << std::dec << i.fixed.offInJ << "]";
+        std::cout << ssp{0} << "[" << NtfsTime(i.fixed.time) << "]";
+        std::cout << ssp{0} << "[FRN " << std::dec
+                  << i.fixed.fileRef.fileRecordNum << "]";
+        std::cout << "[" << wstr2str(i.fileName) << "]";
+        std::cout << ssp{0} << "[";
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_WAS_CREATED) {
+            std::cout << " 文件创建";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_WAS_DELETED) {
+            std::cout << " 文件删除";
+        }
+        if (i.fixed.reason & abkntfs::NtfsUsnJrnl::FILE_CLOSED) {
+            std::cout << " 文件被关闭";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_RENAMED_NEW) {
+            std::cout << " 重命名(显示新名)";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_RENAMED_OLD) {
+            std::cout << " 重命名(显示旧名)";
+        }
+        if (i.fixed.reason &
+            (abkntfs::NtfsUsnJrnl::UNNAMED_DATA_STREAM_WAS_ADDED |
+             abkntfs::NtfsUsnJrnl::UNNAMED_DATA_STREAM_WAS_OVERWRITTEN |
+             abkntfs::NtfsUsnJrnl::UNNAMED_DATA_STREAM_WAS_TRUNCATED)) {
+            std::cout << " 内容被修改";
+        }
+        if (i.fixed.reason & abkntfs::NtfsUsnJrnl::FILE_ATTR_CHANGED) {
+            std::cout << " 属性改变";
+        }
+        if (i.fixed.reason &
+            (abkntfs::NtfsUsnJrnl::NAMED_DATA_STREAM_WAS_ADDED |
+             abkntfs::NtfsUsnJrnl::NAMED_DATA_STREAM_WAS_OVERWRITTEN |
+             abkntfs::NtfsUsnJrnl::NAMED_DATA_STREAM_WAS_TRUNCATED)) {
+            std::cout << " 额外内容被修改";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::ACCESS_RIGHTS_CHANGED) {
+            std::cout << " 访问权限修改";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_COMPRESSED_CHANGED) {
+            std::cout << " 压缩状态改变";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_ENCRYPTED_OR_DECRYPTED) {
+            std::cout << " 加密状态改变";
+        }
+        if (i.fixed.reason &
+            abkntfs::NtfsUsnJrnl::FILE_HARD_LINK_CHANGED) {
+            std::cout << " 硬链接数量改变";
+        }
+        if (i.fixed.reason & abkntfs::NtfsUsnJrnl::FILE_OBJID_CHANGED) {
+            std::cout << " 对象 ID 改变";
+        }
+        std::cout << "]" << std::endl;
+        ShowAttributesFlag(i.fixed.fileAttributes, 2);
+        std::cout << ssp{2} << "所在目录: " << wstr2str(paths.Resolve(i))
+                  << std::endl;
+
+        // std::cout << ssp{2} << "源信息: " << std::dec
+        //           << i.fixed.sourceInfo << std::endl;
+    }
+}
+
+// 按 params 选取 $J 日志, 按 USN 递增顺序交给 callback. 未指定起点时为
+// 最新的 count 条 (count 为 0 时为全部); 指定 USN 或时间时从该处开始正向
+// 读取. 只选取匹配 filter 的日志, 过滤在解码之前进行.
+void SelectUsnEntries(
+    abkntfs::NtfsUsnJrnl &logJ, UsnJrnlParams const &params,
+    std::function<void(abkntfs::NtfsUsnJrnl::JEntry const &entry)> callback) {
+    if (params.usn == (uint64_t)-1 && !params.since && !params.until &&
+        params.count) {
+        for (auto const &i : logJ.GetLastN(params.count, params.filter)) {
+            callback(i);
+        }
+        return;
+    }
+    uint64_t beg = logJ.GetFirstUSN();
+    if (params.usn != (uint64_t)-1) {
+        beg = logJ.SeekUSN(params.usn);
+    }
+    if (params.since) {
+        beg = std::max(beg, logJ.SeekTime(params.since));
+    }
+    uint64_t selected = 0;
+    logJ.ForEach(beg, logJ.GetDataSize(), params.filter,
+                 [&](abkntfs::NtfsUsnJrnl::JEntry const &entry) {
+                     if (params.until && entry.fixed.time >= params.until) {
+                         return false;
+                     }
+                     callback(entry);
+                     return !params.count || ++selected < params.count;
+                 });
+}
+
+// 打印 SelectUsnEntries 选取的日志, 每次打印一批.
+void ShowUsnJrnl(abkntfs::Ntfs &disk, UsnJrnlParams const &params) {
+    abkntfs::NtfsUsnJrnl logJ{disk};
+    abkntfs::NtfsUsnPathResolver paths{disk};
+    const size_t batchSize = 1024;
+    std::vector<abkntfs::NtfsUsnJrnl::JEntry> batch;
+    SelectUsnEntries(logJ, params,
+                     [&](abkntfs::NtfsUsnJrnl::JEntry const &entry) {
+                         batch.push_back(entry);
+                         if (batch.size() == batchSize) {
+                             ShowUsnEntries(paths, batch);
+                             batch.clear();
+                         }
+                     });
+    ShowUsnEntries(paths, batch);
+}
+
+// 把 SelectUsnEntries 选取的日志以列的形式保存到 file. bench 为 true 时
+// 另外以文本形式 (每条一行, 字段以 tab 分隔) 保存到 file.txt, 比较两者的
+// 写入耗时, 文件大小以及重新打开并读取全部字段的耗时.
+void ExportUsnJrnl(abkntfs::Ntfs &disk, UsnJrnlParams const &params,
+                   std::string const &file, bool bench) {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    abkntfs::NtfsUsnJrnl logJ{disk};
+    std::vector<abkntfs::NtfsUsnJrnl::JEntry> entries;
+    abkntfs::NtfsUsnColumns columns{disk};
+    auto beg = Clock::now();
+    SelectUsnEntries(logJ, params,
+                     [&](abkntfs::NtfsUsnJrnl::JEntry const &entry) {
+                         if (bench) {
+                             entries.push_back(entry);
+                         }
+                         else {
+                             columns.Add(entry);
+                         }
+                     });
+    auto read = Clock::now();
+    for (auto const &i : entries) {
+        columns.Add(i);
+    }
+    if (!columns.Save(file)) {
+        std::cout << "无法保存: " << file << std::endl;
+        return;
+    }
+    auto saved = Clock::now();
+    std::ifstream probe(file, std::ios::binary | std::ios::ate);
+    uint64_t binSize = probe.tellg();
+    std::cout << "日志数: " << std::dec << columns.Size()
+              << ", 文件名数: " << columns.GetNamesCount()
+              << ", 文件大小: " << FriendlyFileSize(binSize) << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    if (!bench) {
+        std::cout << "耗时: " << ms(saved - beg) << " ms" << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        return;
+    }
+    std::cout << "读取日志: " << ms(read - beg) << " ms" << std::endl;
+
+    std::string textFile = file + ".txt";
+    auto textBeg = Clock::now();
+    {
+        std::ofstream out(textFile, std::ios::trunc);
+        for (auto const &i : entries) {
+            out << i.fixed.offInJ << '\t' << i.fixed.time << '\t'
+                << i.fixed.reason << '\t' << i.fixed.fileRef.fileRecordNum
+                << '\t' << i.fixed.parentFileRef.fileRecordNum << '\t'
+                << abkntfs::WStringToUtf8(i.fileName) << '\n';
+        }
+    }
+    auto textSaved = Clock::now();
+    probe = std::ifstream(textFile, std::ios::binary | std::ios::ate);
+    uint64_t textSize = probe.tellg();
+
+    // 重新打开并读取所有字段, 文件名只取长度.
+    uint64_t binSum = 0, textSum = 0;
+    auto openBeg = Clock::now();
+    {
+        abkntfs::NtfsUsnColumns loaded{file};
+        for (uint64_t i = 0; i < loaded.Size(); i++) {
+            uint32_t len;
+            loaded.GetNameUtf8(i, len);
+            binSum += loaded.USNs()[i] + loaded.Times()[i] +
+                      loaded.Reasons()[i] +
+                      loaded.GetFileRef(i).fileRecordNum +
+                      loaded.GetParentRef(i).fileRecordNum + len;
+        }
+    }
+    auto openEnd = Clock::now();
+    {
+        std::ifstream in(textFile);
+        uint64_t usn, time, reason, frn, parent;
+        std::string name;
+        while (in >> usn >> time >> reason >> frn >> parent &&
+               in.get() == '\t' && std::getline(in, name)) {
+            textSum += usn + time + reason + frn + parent + name.size();
+        }
+    }
+    auto textEnd = Clock::now();
+    std::cout << "列式: 写入 " << ms(saved - read) << " ms, 大小 "
+              << FriendlyFileSize(binSize) << ", 打开并读取 "
+              << ms(openEnd - openBeg) << " ms" << std::endl;
+    std::cout << "文本: 写入 " << ms(textSaved - textBeg) << " ms, 大小 "
+              << FriendlyFileSize(textSize) << ", 打开并读取 "
+              << ms(textEnd - openEnd) << " ms" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    if (binSum != textSum) {
+        std::cout << "两种格式读取的内容不一致!" << std::endl;
+    }
+}
+
+// 打印 ExportUsnJrnl 保存的文件中的前 count 条日志 (count 为 0 时为全部).
+void ShowUsnColumns(std::string const &file, uint64_t count) {
+    abkntfs::NtfsUsnColumns columns{file};
+    if (!columns.valid) {
+        std::cout << "无法打开: " << file << std::endl;
+        return;
+    }
+    std::cout << "日志数: " << std::dec << columns.Size() << std::endl;
+    uint64_t n = columns.Size();
+    if (count && count < n) n = count;
+    for (uint64_t i = 0; i < n; i++) {
+        std::cout << "[USN " << std::dec << columns.USNs()[i] << "]";
+        std::cout << "[" << NtfsTime(columns.Times()[i]) << "]";
+        std::cout << "[FRN " << columns.GetFileRef(i).fileRecordNum << "]";
+        std::cout << "[" << wstr2str(columns.GetFileName(i)) << "]";
+        std::cout << "[原因 0x" << std::hex << columns.Reasons()[i] << "]";
+        std::cout << "[父目录 " << std::dec
+                  << columns.GetParentRef(i).fileRecordNum << "]"
+                  << std::endl;
+    }
+}
+
+// 持续打印 $J 中新增的日志. 有状态文件时从其中的检查点继续, 否则从指定
+// 的 USN 或时间开始, 都没有则从当前末尾开始. 打印满 count 条或遇到时间
+// 不早于 until 的日志时停止.
+void FollowUsnJrnl(abkntfs::Ntfs &disk, UsnJrnlParams const &params) {
+    abkntfs::NtfsUsnFollower follower{disk};
+    if (!follower.valid) {
+        std::cout << "找不到 $UsnJrnl." << std::endl;
+        return;
+    }
+    abkntfs::NtfsUsnJrnl &logJ = follower.GetUsnJrnl();
+    abkntfs::NtfsUsnPathResolver paths{disk};
+    if (!params.stateFile.empty() && follower.Load(params.stateFile)) {
+        std::cout << "从检查点继续: USN " << std::dec
+                  << follower.GetCheckpoint().nextUSN << std::endl;
+    }
+    else if (params.usn != (uint64_t)-1 || params.since) {
+        uint64_t beg = logJ.GetFirstUSN();
+        if (params.usn != (uint64_t)-1) {
+            beg = logJ.SeekUSN(params.usn);
+        }
+        if (params.since) {
+            beg = std::max(beg, logJ.SeekTime(params.since));
+        }
+        follower.SetPosition(beg);
+    }
+    else {
+        std::cout << "从末尾开始跟踪: USN " << std::dec
+                  << follower.GetCheckpoint().nextUSN << std::endl;
+    }
+    std::vector<abkntfs::NtfsUsnJrnl::JEntry> batch;
+    uint64_t printed = 0;
+    bool done = false;
+    follower.Follow(
+        std::chrono::milliseconds(params.interval), params.filter,
+        [&](abkntfs::NtfsUsnJrnl::JEntry const &entry) {
+            if (params.until && entry.fixed.time >= params.until) {
+                done = true;
+                return false;
+            }
+            batch.push_back(entry);
+            if (batch.size() == 1024) {
+                ShowUsnEntries(paths, batch);
+                batch.clear();
+            }
+            done = params.count && ++printed >= params.count;
+            return !done;
+        },
+        [&](abkntfs::NtfsUsnFollower::PollStats const &stats) {
+            ShowUsnEntries(paths, batch);
+            batch.clear();
+            if (stats.reset) {
+                std::cout << "日志已重建, 从头读取." << std::endl;
+            }
+            if (stats.lostBytes) {
+                std::cout << "日志已被释放, 丢失 " << std::dec
+                          << stats.lostBytes << " 字节." << std::endl;
+            }
+            if (stats.ok && !params.stateFile.empty() &&
+                !follower.Save(params.stateFile)) {
+                std::cout << "无法保存状态文件: " << params.stateFile
+                          << std::endl;
+                return false;
+            }
+            return !done;
+        });
+}
+
 // 显示 文件记录 的 16 进制数据
 void ShowFileRecordHex(abkntfs::Ntfs &disk, uint64_t idx,
                        uint32_t preSpace = 2) {
@@ -452,7 +1187,7 @@ class CommandParser {
         return ret;
     }
 
-    static uint64_t ToUll(std::string &text) {
+    static uint64_t ToUll(std::string const &text) {
         try {
             return std::stoull(text);
         }
@@ -489,19 +1224,71 @@ private:
         bool hex = false;
         // 显示目录文件
         bool dir = false;
-        // 打印 $J 日志最后多少条记录
+        // 打印 $J 日志
+        bool logJ = false;
+        // 打印的日志条数
         Exists<uint64_t> logJn;
+        // 从此 USN 开始正向打印日志
+        Exists<uint64_t> usn;
+        // 打印此时间之后, 之前的日志
+        std::string since;
+        std::string until;
+        // 日志过滤条件: 原因, 源信息, 文件记录号, 父目录, 文件名通配符
+        std::string reason;
+        Exists<uint64_t> source;
+        std::string file;
+        std::string parent;
+        std::string name;
+        // 以列的形式导出日志的文件, 打印导出的文件
+        std::string exportFile;
+        std::string columns;
+        // 持续打印新增的日志, 检查点的状态文件, 轮询间隔 (毫秒)
+        bool follow = false;
+        std::string state;
+        Exists<uint64_t> interval;
         // 单独出现打印分卷信息; 跟 attrId 组合打印属性 data runs 的对应扇区.
         bool info = false;
         // 打印指定属性
         Exists<uint64_t> attrId;
         // 打印一个空闲位置
         Exists<uint64_t> freeUnit;
+        // 打印块缓存统计
+        bool cache = false;
+        // 打印异步读取统计
+        bool io = false;
+        // 从指定文件记录号开始扫描整个 MFT
+        Exists<uint64_t> scanFrom;
+        // 并行扫描的线程数
+        uint64_t threads = 0;
+        // 并行扫描时不按文件记录号顺序交付
+        bool unordered = false;
+        // 扫描时包含未使用的文件记录
+        bool all = false;
+        // 建立整个卷的路径表
+        bool paths = false;
+        // 打印路径表中的所有路径
+        bool list = false;
+        // 路径表的加载和保存位置
+        std::string load;
+        std::string save;
+        // 通过路径表列出目录, 递归列出目录
+        Exists<uint64_t> ls;
+        Exists<uint64_t> tree;
+        // 在目录中查找文件名
+        std::string find;
+        // 从此目录开始并行递归遍历
+        Exists<uint64_t> walk;
+        // 递归遍历的最大深度
+        Exists<uint64_t> depth;
+        // 递归遍历时展开重解析点
+        bool reparse = false;
+        // 对目录中每个文件名查找的轮数, 用于测量查找耗时
+        Exists<uint64_t> bench;
     };
 
 public:
     abkntfs::Ntfs disk;
-    CommandParser(abkntfs::Ntfs &disk) { this->disk = std::move(disk); };
+    CommandParser(abkntfs::Ntfs &&disk) { this->disk = std::move(disk); };
     void Parse(std::string cmd) {
         std::string param = PopParameter(cmd);
         if (compareStrNoCase(param, "p")) {
@@ -524,11 +1311,54 @@ public:
                     ps.dir = true;
                 }
                 if (compareStrNoCase(param, "logJ")) {
-                    ps.logJn = ToUll(PopParameter(cmd));
-                    if (ps.logJn == 0) {
-                        ps.logJn = 10;
+                    ps.logJ = true;
+                    // 条数可以省略, 后面不是数字时不取出.
+                    std::string rest = cmd;
+                    uint64_t n = ToUll(PopParameter(rest));
+                    if (n) {
+                        ps.logJn = n;
+                        cmd = rest;
                     }
                 }
+                if (compareStrNoCase(param, "usn")) {
+                    ps.usn = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "since")) {
+                    ps.since = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "until")) {
+                    ps.until = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "reason")) {
+                    ps.reason = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "export")) {
+                    ps.exportFile = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "columns")) {
+                    ps.columns = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "follow")) {
+                    ps.follow = true;
+                }
+                if (compareStrNoCase(param, "state")) {
+                    ps.state = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "interval")) {
+                    ps.interval = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "source")) {
+                    ps.source = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "file")) {
+                    ps.file = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "parent")) {
+                    ps.parent = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "name")) {
+                    ps.name = PopParameter(cmd);
+                }
                 if (compareStrNoCase(param, "info")) {
                     ps.info = true;
                 }
@@ -538,6 +1368,71 @@ public:
                 if (compareStrNoCase(param, "free")) {
                     ps.freeUnit = ToUll(PopParameter(cmd));
                 }
+                if (compareStrNoCase(param, "cache")) {
+                    ps.cache = true;
+                }
+                if (compareStrNoCase(param, "io")) {
+                    ps.io = true;
+                }
+                if (compareStrNoCase(param, "scan")) {
+                    ps.scanFrom = 0;
+                    // 起始文件记录号可以省略, 后面不是数字时不取出.
+                    std::string rest = cmd;
+                    uint64_t n = ToUll(PopParameter(rest));
+                    if (n) {
+                        ps.scanFrom = n;
+                        cmd = rest;
+                    }
+                }
+                if (compareStrNoCase(param, "threads")) {
+                    ps.threads = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "unordered")) {
+                    ps.unordered = true;
+                }
+                if (compareStrNoCase(param, "all")) {
+                    ps.all = true;
+                }
+                if (compareStrNoCase(param, "paths")) {
+                    ps.paths = true;
+                }
+                if (compareStrNoCase(param, "list")) {
+                    ps.list = true;
+                }
+                if (compareStrNoCase(param, "load")) {
+                    ps.load = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "save")) {
+                    ps.save = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "ls")) {
+                    ps.ls = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "tree")) {
+                    ps.tree = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "walk")) {
+                    ps.walk = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "depth")) {
+                    ps.depth = ToUll(PopParameter(cmd));
+                }
+                if (compareStrNoCase(param, "reparse")) {
+                    ps.reparse = true;
+                }
+                if (compareStrNoCase(param, "find")) {
+                    ps.find = PopParameter(cmd);
+                }
+                if (compareStrNoCase(param, "bench")) {
+                    ps.bench = 1;
+                    // 轮数可以省略, 后面不是数字时不取出.
+                    std::string rest = cmd;
+                    uint64_t n = ToUll(PopParameter(rest));
+                    if (n) {
+                        ps.bench = n;
+                        cmd = rest;
+                    }
+                }
             }
             Print(ps);
         }
@@ -566,6 +1461,12 @@ public:
                     }
                 }
             }
+            else if (!ps.find.empty()) {
+                FindDirFile(disk.GetFileRecordByFRN(ps.FRN), ps.find);
+            }
+            else if (ps.bench.ex()) {
+                BenchDirFind(disk.GetFileRecordByFRN(ps.FRN), ps.bench);
+            }
             else if (ps.dir) {
                 ShowDirFiles(disk.GetFileRecordByFRN(ps.FRN));
             }
@@ -604,79 +1505,50 @@ public:
             }
             flag = true;
         }
-        else if (ps.logJn.ex()) {
-            abkntfs::NtfsUsnJrnl logJ{disk};
-            auto logRecs = logJ.GetLastN(ps.logJn);
-            for (auto &i : logRecs) {
-                std::cout << "[USN " << std::dec << i.fixed.offInJ << "]";
-                std::cout << ssp{0} << "[" << NtfsTime(i.fixed.time) << "]";
-                std::cout << ssp{0} << "[FRN " << std::dec
-                          << i.fixed.fileRef.fileRecordNum << "]";
-                std::cout << "[" << wstr2str(i.fileName) << "]";
-                std::cout << ssp{0} << "[";
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_WAS_CREATED) {
-                    std::cout << " 文件创建";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_WAS_DELETED) {
-                    std::cout << " 文件删除";
-                }
-                if (i.fixed.reason & abkntfs::NtfsUsnJrnl::FILE_CLOSED) {
-                    std::cout << " 文件被关闭";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_RENAMED_NEW) {
-                    std::cout << " 重命名(显示新名)";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_OR_DIRECTORY_RENAMED_OLD) {
-                    std::cout << " 重命名(显示旧名)";
-                }
-                if (i.fixed.reason &
-                    (abkntfs::NtfsUsnJrnl::UNNAMED_DATA_STREAM_WAS_ADDED |
-                     abkntfs::NtfsUsnJrnl::UNNAMED_DATA_STREAM_WAS_OVERWRITTEN |
-                     abkntfs::NtfsUsnJrnl::UNNAMED_DATA_STREAM_WAS_TRUNCATED)) {
-                    std::cout << " 内容被修改";
-                }
-                if (i.fixed.reason & abkntfs::NtfsUsnJrnl::FILE_ATTR_CHANGED) {
-                    std::cout << " 属性改变";
-                }
-                if (i.fixed.reason &
-                    (abkntfs::NtfsUsnJrnl::NAMED_DATA_STREAM_WAS_ADDED |
-                     abkntfs::NtfsUsnJrnl::NAMED_DATA_STREAM_WAS_OVERWRITTEN |
-                     abkntfs::NtfsUsnJrnl::NAMED_DATA_STREAM_WAS_TRUNCATED)) {
-                    std::cout << " 额外内容被修改";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::ACCESS_RIGHTS_CHANGED) {
-                    std::cout << " 访问权限修改";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_COMPRESSED_CHANGED) {
-                    std::cout << " 压缩状态改变";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_ENCRYPTED_OR_DECRYPTED) {
-                    std::cout << " 加密状态改变";
-                }
-                if (i.fixed.reason &
-                    abkntfs::NtfsUsnJrnl::FILE_HARD_LINK_CHANGED) {
-                    std::cout << " 硬链接数量改变";
-                }
-                if (i.fixed.reason & abkntfs::NtfsUsnJrnl::FILE_OBJID_CHANGED) {
-                    std::cout << " 对象 ID 改变";
-                }
-                std::cout << "]" << std::endl;
-                ShowAttributesFlag(i.fixed.fileAttributes, 2);
-                abkntfs::NtfsFileRecord t =
-                    disk.GetFileRecordByFRN(i.fixed.fileRef.fileRecordNum);
-                std::cout << ssp{2}
-                          << "所在目录: " << wstr2str(disk.GetFilePath(t))
+        else if (ps.logJ) {
+            UsnJrnlParams params;
+            bool forward = ps.usn.ex() || !ps.since.empty() ||
+                           !ps.until.empty() || ps.follow ||
+                           !ps.exportFile.empty();
+            params.count = ps.logJn.ex() ? (uint64_t)ps.logJn
+                                         : (forward ? 0 : 10);
+            if (ps.usn.ex()) params.usn = ps.usn;
+            params.since = ParseNtfsTime(ps.since);
+            params.until = ParseNtfsTime(ps.until);
+            if ((!ps.since.empty() && !params.since) ||
+                (!ps.until.empty() && !params.until)) {
+                std::cout << "无法解析时间, 格式为 YYYY-MM-DDTHH:MM:SS."
                           << std::endl;
-
-                // std::cout << ssp{2} << "源信息: " << std::dec
-                //           << i.fixed.sourceInfo << std::endl;
+                return;
+            }
+            abkntfs::NtfsUsnJrnl::Filter &filter = params.filter;
+            if (!ps.reason.empty() &&
+                !ParseUsnReasons(ps.reason, filter.reasonMask)) {
+                std::cout << "无法解析原因: " << ps.reason << std::endl;
+                return;
+            }
+            if (ps.source.ex()) {
+                filter.sourceInfoMask = 0xFFFFFFFF;
+                filter.sourceInfoValue = (uint32_t)ps.source;
+            }
+            filter.FRNs = ParseFRNList(ps.file);
+            filter.parentFRNs = ParseFRNList(ps.parent);
+            filter.nameGlob = str2wstr(ps.name);
+            if (!ps.columns.empty()) {
+                ShowUsnColumns(ps.columns, params.count);
+            }
+            else if (!ps.exportFile.empty()) {
+                ExportUsnJrnl(disk, params, ps.exportFile, ps.bench.ex());
+            }
+            else if (ps.follow) {
+                params.stateFile = ps.state;
+                if (ps.interval.ex() && ps.interval) {
+                    params.interval = ps.interval;
+                }
+                FollowUsnJrnl(disk, params);
+            }
+            else {
+                ShowUsnJrnl(disk, params);
             }
             flag = true;
         }
@@ -710,6 +1582,39 @@ public:
             ShowVolumeInfo(disk);
             flag = true;
         }
+        else if (ps.cache) {
+            ShowBlockCacheStats(disk);
+            flag = true;
+        }
+        else if (ps.io) {
+            ShowAsyncReaderStats(disk);
+            flag = true;
+        }
+        else if (ps.scanFrom.ex()) {
+            ScanMft(disk, ps.scanFrom, (uint32_t)ps.threads, !ps.unordered,
+                    ps.all);
+            flag = true;
+        }
+        else if (ps.walk.ex()) {
+            abkntfs::NtfsTreeWalker::Options options;
+            options.workers = (uint32_t)ps.threads;
+            if (ps.depth.ex()) options.maxDepth = (uint32_t)ps.depth;
+            options.followReparse = ps.reparse;
+            WalkTree(disk, ps.walk, options, ps.list);
+            flag = true;
+        }
+        else if (ps.paths) {
+            PathTableParams params;
+            params.threads = (uint32_t)ps.threads;
+            params.list = ps.list;
+            params.load = ps.load;
+            params.save = ps.save;
+            if (ps.ls.ex()) params.ls = ps.ls;
+            if (ps.tree.ex()) params.tree = ps.tree;
+            params.find = ps.find;
+            ShowPathTable(disk, params);
+            flag = true;
+        }
         // 不能被执行
         if (!flag) {
             std::cout << "无法解析此命令." << std::endl;
@@ -717,9 +1622,9 @@ public:
     }
 };
 
-int main() {
+int main(int argc, char *argv[]) {
     // 选择并加载卷
-    abkntfs::Ntfs disk = LoadVolume();
+    abkntfs::Ntfs disk = LoadVolume(argc, argv);
     // tamper::Ntfs disk2 = std::move(disk);
     int choose = 0;
 
@@ -735,7 +1640,9 @@ int main() {
 
     CommandParser parser(std::move(disk));
 
+#ifdef _WIN32
     getchar();
+#endif
     while (true) {
         std::cout << "> ";
         std::string cmd;
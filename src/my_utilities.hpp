@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <chrono>
 #include <clocale>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
@@ -36,7 +38,11 @@ std::string wstr2str(const std::wstring &ws) {
     if (pcurLocale != nullptr) {
         curLocale.assign(pcurLocale);
     }
+#ifdef _WIN32
     ::setlocale(LC_CTYPE, "chs");
+#else
+    ::setlocale(LC_CTYPE, "");
+#endif
     const wchar_t *_Source = ws.c_str();
     size_t _Dsize = 2 * ws.size() + 1;
     char *_Dest = new char[_Dsize];
@@ -56,7 +62,7 @@ struct ssp {
     uint32_t preSpace;
     template <class _Elem, class _Traits>
     typename std::basic_ostream<_Elem, _Traits> &
-    operator()(typename std::basic_ostream<_Elem, _Traits> &_Ostr) {
+    operator()(typename std::basic_ostream<_Elem, _Traits> &_Ostr) const {
         uint32_t sp = preSpace;
         while (sp--) {
             _Ostr.put(_Ostr.widen(' '));
@@ -66,7 +72,7 @@ struct ssp {
 };
 
 template <class _Elem, class _Traits>
-auto operator<<(std::basic_ostream<_Elem, _Traits> &_Ostr, ssp &sps)
+auto operator<<(std::basic_ostream<_Elem, _Traits> &_Ostr, ssp const &sps)
     -> std::basic_ostream<_Elem, _Traits> & {
     return sps(_Ostr);
 }
@@ -103,6 +109,31 @@ std::string NtfsTime(uint64_t time) {
     return ret;
 }
 
+// 解析 "YYYY-MM-DD[THH:MM[:SS]]" 格式的本地时间 (与 NtfsTime 显示的一致)
+// 为 NTFS 时间, 纯数字视为 NTFS 时间本身. 失败返回 0.
+uint64_t ParseNtfsTime(std::string const &text) {
+    if (text.empty()) return 0;
+    if (text.find_first_not_of("0123456789") == std::string::npos) {
+        try {
+            return std::stoull(text);
+        }
+        catch (...) {
+            return 0;
+        }
+    }
+    std::tm tm = {};
+    int n = sscanf(text.c_str(), "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon,
+                   &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+    if (n != 3 && n < 5) return 0;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+    tm.tm_isdst = -1;
+    std::time_t t = std::mktime(&tm);
+    if (t < 0) return 0;
+    // 1601-01-01 到 1970-01-01 的秒数, 单位换算为 100 纳秒.
+    return ((uint64_t)t + 11644473600ull) * 10000000ull;
+}
+
 // 展示 16 进制数据
 void ShowHex(char const *data, uint64_t len, int width = 32, int preWhite = 0,
              uint32_t divisionHeight = (uint32_t)-1, bool showAscii = true) {
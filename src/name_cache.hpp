@@ -0,0 +1,113 @@
+#pragma once
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+namespace abkntfs {
+    // 文件记录号到 (父目录记录号, 序列号, 文件名) 的缓存, 以及目录路径前缀的
+    // 缓存. 条目数超出容量时整体清空.
+    class FileNameCache {
+    public:
+        struct Entry {
+            // 父目录的文件记录号及序列号
+            uint64_t parent;
+            uint16_t parentSeq;
+            // 文件记录的序列号, 用于校验引用是否过期
+            uint16_t seq;
+            std::wstring name;
+        };
+
+        struct Stats {
+            // 文件名条目命中与未命中次数
+            uint64_t hits;
+            uint64_t misses;
+            // 路径前缀命中次数
+            uint64_t prefixHits;
+            // 当前缓存的文件名条目数与路径前缀数
+            uint64_t entries;
+            uint64_t prefixes;
+        };
+
+    private:
+        struct Prefix {
+            uint16_t seq;
+            std::wstring path;
+        };
+
+        std::mutex lock;
+        std::unordered_map<uint64_t, Entry> names;
+        std::unordered_map<uint64_t, Prefix> prefixes;
+        // 缓存的路径前缀所用的分隔符
+        std::wstring sep;
+        uint64_t capacity;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t prefixHits = 0;
+
+    public:
+        // capacity: 文件名条目和路径前缀各自的最大数量, 为 0 表示不缓存.
+        FileNameCache(uint64_t capacity) : capacity(capacity) {}
+
+        FileNameCache(FileNameCache const &r) = delete;
+        FileNameCache &operator=(FileNameCache const &r) = delete;
+
+        // seq 与缓存的序列号不一致时视为未命中.
+        bool Get(uint64_t FRN, uint16_t seq, Entry &out) {
+            std::lock_guard<std::mutex> guard(lock);
+            auto it = names.find(FRN);
+            if (it == names.end() || it->second.seq != seq) {
+                misses++;
+                return false;
+            }
+            out = it->second;
+            hits++;
+            return true;
+        }
+
+        void Put(uint64_t FRN, Entry const &entry) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!capacity) return;
+            if (names.size() >= capacity) names.clear();
+            names[FRN] = entry;
+        }
+
+        // 目录 FRN 下的文件的路径前缀 (以 sep 结尾).
+        bool GetPrefix(uint64_t FRN, uint16_t seq, std::wstring const &sep,
+                       std::wstring &out) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (sep != this->sep) return false;
+            auto it = prefixes.find(FRN);
+            if (it == prefixes.end() || it->second.seq != seq) {
+                return false;
+            }
+            out = it->second.path;
+            prefixHits++;
+            return true;
+        }
+
+        void PutPrefix(uint64_t FRN, uint16_t seq, std::wstring const &sep,
+                       std::wstring const &path) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!capacity) return;
+            if (sep != this->sep) {
+                prefixes.clear();
+                this->sep = sep;
+            }
+            if (prefixes.size() >= capacity) prefixes.clear();
+            prefixes[FRN] = Prefix{seq, path};
+        }
+
+        void Clear() {
+            std::lock_guard<std::mutex> guard(lock);
+            names.clear();
+            prefixes.clear();
+        }
+
+        Stats GetStats() {
+            std::lock_guard<std::mutex> guard(lock);
+            return Stats{hits, misses, prefixHits, names.size(),
+                         prefixes.size()};
+        }
+    };
+}
@@ -1,5 +1,10 @@
 #pragma once
+#include "block_cache.hpp"
 #include "disk_reader.hpp"
+#include "name_cache.hpp"
+#include "ntfs_upcase.hpp"
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <iterator>
 #include <memory>
@@ -21,6 +26,51 @@ namespace abkntfs {
     };
     using NtfsSectorsInfo = std::vector<NtfsSectors>;
 
+    // 虚拟扇区号到逻辑扇区号的映射. 记录每段起始虚拟扇区号的前缀和, 按虚拟
+    // 扇区号二分查找所在的段, 每次转换为 O(log n).
+    class NtfsExtentMap {
+        NtfsSectorsInfo runs;
+        // 第 i 段的起始虚拟扇区号, 最后一个元素为总扇区数.
+        std::vector<uint64_t> vsnBeg;
+
+    public:
+        NtfsExtentMap() : vsnBeg(1, 0) {}
+        NtfsExtentMap(NtfsSectorsInfo const &runs) : runs(runs), vsnBeg(1, 0) {
+            vsnBeg.reserve(runs.size() + 1);
+            for (auto &i : runs) {
+                vsnBeg.push_back(vsnBeg.back() + i.secNum);
+            }
+        }
+
+        NtfsSectorsInfo const &GetRuns() const { return runs; }
+
+        uint64_t GetSectorsCount() const { return vsnBeg.back(); }
+
+        // 虚拟扇区 [vsn, vsn + secNum) 对应的逻辑扇区, 越界抛出异常.
+        NtfsSectorsInfo Translate(uint64_t vsn, uint64_t secNum) const {
+            NtfsSectorsInfo ret;
+            if (vsn > GetSectorsCount() || secNum > GetSectorsCount() - vsn) {
+                throw std::runtime_error{"Too many sectors requested!"};
+            }
+            if (!secNum) {
+                return ret;
+            }
+            size_t i = std::upper_bound(vsnBeg.begin(), vsnBeg.end(), vsn) -
+                       vsnBeg.begin() - 1;
+            for (; secNum; i++) {
+                uint64_t skip = vsn - vsnBeg[i];
+                uint64_t n = std::min(runs[i].secNum - skip, secNum);
+                if (n) {
+                    ret.emplace_back(runs[i].startSecId + skip, n,
+                                     runs[i].sparse);
+                }
+                vsn += n;
+                secNum -= n;
+            }
+            return ret;
+        }
+    };
+
     enum NTFS_ATTRIBUTES_TYPE : uint32_t {
         NTFS_ATTRIBUTE_NONE = 0x00,
         NTFS_STANDARD_INFOMATION = 0x10,
@@ -61,25 +111,151 @@ namespace abkntfs {
     class Ntfs_MFT_Record;
     class Ntfs;
     class NtfsDataRuns;
+
+    // 把 UTF16-LE 编码的名称转为 std::wstring. Windows 下 wchar_t 就是
+    // UTF-16, 直接拷贝; 其他平台 wchar_t 为 32 位, 需逐个码元(含代理对)转换.
+    inline std::wstring Utf16ToWString(char const *data, uint64_t charCount) {
+#ifdef _WIN32
+        return std::wstring((wchar_t const *)data, charCount);
+#else
+        std::wstring ret;
+        ret.reserve(charCount);
+        for (uint64_t i = 0; i < charCount; i++) {
+            uint16_t hi, lo;
+            memcpy(&hi, data + (i << 1), sizeof(hi));
+            if (hi >= 0xD800 && hi < 0xDC00 && i + 1 < charCount) {
+                memcpy(&lo, data + ((i + 1) << 1), sizeof(lo));
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    ret.push_back(0x10000 + ((hi - 0xD800) << 10) +
+                                  (lo - 0xDC00));
+                    i++;
+                    continue;
+                }
+            }
+            ret.push_back(hi);
+        }
+        return ret;
+#endif
+    }
+
+    // Utf16ToWString 的逆操作.
+    inline std::u16string WStringToUtf16(std::wstring const &str) {
+#ifdef _WIN32
+        return std::u16string(str.begin(), str.end());
+#else
+        std::u16string ret;
+        ret.reserve(str.size());
+        for (wchar_t c : str) {
+            uint32_t cp = (uint32_t)c;
+            if (cp >= 0x10000 && cp < 0x110000) {
+                cp -= 0x10000;
+                ret.push_back((char16_t)(0xD800 + (cp >> 10)));
+                ret.push_back((char16_t)(0xDC00 + (cp & 0x3FF)));
+            }
+            else {
+                ret.push_back((char16_t)cp);
+            }
+        }
+        return ret;
+#endif
+    }
+
+    // 转为 UTF-8, 不成对的代理项按其数值编码.
+    inline std::string WStringToUtf8(std::wstring const &str) {
+        std::u16string u16 = WStringToUtf16(str);
+        std::string ret;
+        ret.reserve(u16.size());
+        for (size_t i = 0; i < u16.size(); i++) {
+            uint32_t cp = u16[i];
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 1 < u16.size() &&
+                u16[i + 1] >= 0xDC00 && u16[i + 1] < 0xE000) {
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (u16[i + 1] - 0xDC00);
+                i++;
+            }
+            if (cp < 0x80) {
+                ret.push_back((char)cp);
+            }
+            else if (cp < 0x800) {
+                ret.push_back((char)(0xC0 | (cp >> 6)));
+                ret.push_back((char)(0x80 | (cp & 0x3F)));
+            }
+            else if (cp < 0x10000) {
+                ret.push_back((char)(0xE0 | (cp >> 12)));
+                ret.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+                ret.push_back((char)(0x80 | (cp & 0x3F)));
+            }
+            else {
+                ret.push_back((char)(0xF0 | (cp >> 18)));
+                ret.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+                ret.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+                ret.push_back((char)(0x80 | (cp & 0x3F)));
+            }
+        }
+        return ret;
+    }
+
+    // WStringToUtf8 的逆操作, 无效的字节转为 U+FFFD.
+    inline std::wstring Utf8ToWString(char const *data, uint64_t len) {
+        std::u16string u16;
+        u16.reserve(len);
+        uint64_t i = 0;
+        while (i < len) {
+            uint8_t c = (uint8_t)data[i];
+            // 后续字节数
+            uint32_t n = 0;
+            uint32_t cp = c;
+            if (c >= 0xC0) {
+                n = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : 1;
+                cp = c & (0x3F >> n);
+            }
+            bool ok = c < 0x80 || (n && i + n < len);
+            for (uint32_t k = 1; ok && k <= n; k++) {
+                uint8_t t = (uint8_t)data[i + k];
+                ok = (t & 0xC0) == 0x80;
+                cp = (cp << 6) | (t & 0x3F);
+            }
+            if (!ok || cp >= 0x110000) {
+                u16.push_back(0xFFFD);
+                i++;
+                continue;
+            }
+            i += n + 1;
+            if (cp >= 0x10000) {
+                cp -= 0x10000;
+                u16.push_back((char16_t)(0xD800 + (cp >> 10)));
+                u16.push_back((char16_t)(0xDC00 + (cp & 0x3FF)));
+            }
+            else {
+                u16.push_back((char16_t)cp);
+            }
+        }
+        return Utf16ToWString((char const *)u16.data(), u16.size());
+    }
 }
 
 namespace abkntfs {
     struct NtfsDataBlock {
     private:
-        std::shared_ptr<std::vector<char>> pVector;
+        // 数据缓冲区的起始位置, 同时共享缓冲区所有者 (std::vector<char>
+        // 或内存映射) 的所有权, 以保证数据的生命周期.
+        std::shared_ptr<char> pBuffer;
+        // 缓冲区总大小
+        uint64_t bufferSize;
         uint64_t const offset;
         uint64_t length;
+        // 是否为只读视图 (直接指向内存映射), 需要修改数据时先 Copy().
+        bool readOnly;
 
     public:
         char *const pData;
         Ntfs *const pNtfs;
         NtfsDataBlock()
-            : pVector(), pData(nullptr), length(0), offset(0), pNtfs(nullptr){};
+            : pBuffer(), bufferSize(0), offset(0), length(0), readOnly(false),
+              pData(nullptr), pNtfs(nullptr){};
         NtfsDataBlock(NtfsDataBlock const &r)
-            : offset(r.offset), pData(r.pData), pNtfs(r.pNtfs) {
-            this->pVector = r.pVector;
-            this->length = r.length;
-        }
+            : pBuffer(r.pBuffer), bufferSize(r.bufferSize), offset(r.offset),
+              length(r.length), readOnly(r.readOnly), pData(r.pData),
+              pNtfs(r.pNtfs) {}
 
         NtfsDataBlock &operator=(NtfsDataBlock const &r) {
             NtfsDataBlock temp = r;
@@ -90,23 +266,26 @@ namespace abkntfs {
 
         // 拷贝 r 的数据
         NtfsDataBlock(std::vector<char> const &r, Ntfs *pNtfs)
-            : pData{(pVector = std::make_shared<std::vector<char>>(r))
-                        .get()
-                        ->data()},
-              pNtfs{pNtfs}, offset(0) {
-            // pVector = std::make_shared<std::vector<char>>(r);
-            // pData = pVector.get()->data();
-            length = pVector.get()->size();
-            // this->pNtfs = pNtfs;
-        }
+            : NtfsDataBlock(std::make_shared<std::vector<char>>(r), pNtfs) {}
+
+        // 接管 r 的数据, 不进行拷贝
+        NtfsDataBlock(std::vector<char> &&r, Ntfs *pNtfs)
+            : NtfsDataBlock(std::make_shared<std::vector<char>>(std::move(r)),
+                            pNtfs) {}
+
+        // 只读视图, 不拷贝数据. view 需持有数据所有者(如内存映射) 的所有权.
+        NtfsDataBlock(std::shared_ptr<char> view, uint64_t len, Ntfs *pNtfs)
+            : pBuffer(std::move(view)), bufferSize(len), offset(0),
+              length(len), readOnly(true), pData(pBuffer.get()),
+              pNtfs(pNtfs) {}
 
         // 构造 r 的数据视图, 不需要注意 r 的生命周期
         NtfsDataBlock(NtfsDataBlock const &r, uint64_t offset,
                       uint64_t len = (uint64_t)-1)
-            : pVector{r.pVector}, offset(offset + r.offset),
-              pData{&r.pVector.get()->data()[this->offset]}, pNtfs{r.pNtfs},
-              length(len) {
-            if (offset > r.pVector.get()->size()) {
+            : pBuffer{r.pBuffer}, bufferSize(r.bufferSize),
+              offset(offset + r.offset), length(len), readOnly(r.readOnly),
+              pData{r.pBuffer.get() + this->offset}, pNtfs{r.pNtfs} {
+            if (this->offset > r.bufferSize) {
                 this->~NtfsDataBlock();
                 new (this) NtfsDataBlock();
             }
@@ -139,11 +318,20 @@ namespace abkntfs {
 
         uint64_t len() const { return length; }
 
+        // 是否为只读视图 (数据来自内存映射)
+        bool IsReadOnly() const { return readOnly; }
+
         // 生成自身数据的副本 (只截取 offset 和 len 的片段拷贝)
         NtfsDataBlock Copy() const {
             return NtfsDataBlock(std::vector<char>(pData, pData + length),
                                  pNtfs);
         }
+
+    private:
+        NtfsDataBlock(std::shared_ptr<std::vector<char>> vec, Ntfs *pNtfs)
+            : pBuffer(vec, vec->data()), bufferSize(vec->size()), offset(0),
+              length(vec->size()), readOnly(false), pData(pBuffer.get()),
+              pNtfs(pNtfs) {}
     };
 
     // 子类要求:
@@ -219,7 +407,7 @@ namespace abkntfs {
     class NtfsBoot {
     public:
         char bootLoaderRoutine[3];
-        wchar_t systemId[4];
+        char systemId[8];
         uint16_t bytesPerSector;
         uint8_t sectorsPerCluster;
         char unused1[7];
@@ -238,11 +426,13 @@ namespace abkntfs {
         char data[0x1b8];
 
         NtfsBoot() = default;
-        NtfsBoot(std::vector<char> &sectorData) {
-            memcpy_s(this, 512, sectorData.data(), sectorData.size());
+        NtfsBoot(std::vector<char> const &sectorData) {
+            *this = sectorData;
         }
-        NtfsBoot &operator=(std::vector<char> &sectorData) {
-            memcpy_s(this, 512, sectorData.data(), sectorData.size());
+        NtfsBoot &operator=(std::vector<char> const &sectorData) {
+            // 扇区可能大于 512 字节 (4K 扇区), 只取前 512 字节.
+            memcpy_s(this, 512, sectorData.data(),
+                     std::min<size_t>(sectorData.size(), 512));
             return *this;
         }
         operator std::vector<char>() {
@@ -272,25 +462,170 @@ namespace abkntfs {
         uint32_t FileRecordSize;
         // MFT 表中文件记录的数量
         uint32_t FileRecordsCount;
+        // 块缓存的默认容量 (单位: 字节)
+        static const uint64_t DefaultBlockCacheSize = 64ull << 20;
+        // 文件名缓存的默认条目数
+        static const uint64_t DefaultNameCacheEntries = 1ull << 20;
+        // GetFilePath 最多向上查找的目录层数, 防止损坏的卷出现环.
+        static const uint32_t MaxPathDepth = 4096;
+        // $UpCase 的文件记录号
+        static const uint64_t UpCaseFRN = 10;
+
+    private:
+        // 位于 ReadSectors 与 DiskReader 之间的簇缓存, 内存映射模式下不启用.
+        std::shared_ptr<BlockCache> blockCache;
+        // $MFT:$DATA 的扇区映射
+        NtfsExtentMap mftExtents;
+        // GetFilePath 使用的文件名及路径前缀缓存
+        std::shared_ptr<FileNameCache> nameCache;
+        // 打开卷时读取的 $UpCase, 读取失败为空.
+        std::shared_ptr<NtfsUpCase> upCase;
+
+        // 拷贝 [secId, secId + secNum) 与第 lcn 簇重叠的部分到 dest.
+        void CopyClusterOverlap(uint64_t secId, uint64_t secNum, char *dest,
+                                uint64_t lcn, char const *cluster) {
+            uint64_t spc = bootInfo.sectorsPerCluster;
+            uint64_t secSize = GetSectorSize();
+            uint64_t from = std::max(secId, lcn * spc);
+            uint64_t to = std::min(secId + secNum, lcn * spc + spc);
+            memcpy(dest + (from - secId) * secSize,
+                   cluster + (from - lcn * spc) * secSize,
+                   (to - from) * secSize);
+        }
+
+        // 经过块缓存批量读取. 以簇为单位缓存, 所有请求中未命中的簇收集后
+        // 交给 ReadBatch 合并读取.
+        void ReadSectorsCached(std::vector<SectorsRequest> const &reqs) {
+            if (!blockCache || !blockCache->Enabled()) {
+                ReadBatch(reqs);
+                return;
+            }
+            struct MissRun {
+                uint64_t lcn;
+                uint64_t num;
+                size_t req;
+            };
+            uint64_t spc = bootInfo.sectorsPerCluster;
+            uint64_t clusterSize = blockCache->GetBlockSize();
+            std::vector<char> cluster(clusterSize);
+            std::vector<MissRun> misses;
+            uint64_t missNum = 0;
+            for (size_t r = 0; r < reqs.size(); r++) {
+                SectorsRequest const &i = reqs[r];
+                if (i.secNum == 0) continue;
+                uint64_t lastLcn = (i.startSecId + i.secNum - 1) / spc;
+                for (uint64_t lcn = i.startSecId / spc; lcn <= lastLcn; lcn++) {
+                    if (blockCache->Get(lcn, cluster.data())) {
+                        CopyClusterOverlap(i.startSecId, i.secNum, i.dest, lcn,
+                                           cluster.data());
+                        continue;
+                    }
+                    if (!misses.empty() && misses.back().req == r &&
+                        misses.back().lcn + misses.back().num == lcn) {
+                        misses.back().num++;
+                    }
+                    else {
+                        misses.push_back({lcn, 1, r});
+                    }
+                    missNum++;
+                }
+            }
+            if (misses.empty()) return;
+            std::vector<char> buf(missNum * clusterSize);
+            std::vector<SectorsRequest> missReqs;
+            uint64_t off = 0;
+            for (auto const &m : misses) {
+                missReqs.emplace_back(m.lcn * spc, m.num * spc, &buf[0] + off);
+                off += m.num * clusterSize;
+            }
+            try {
+                ReadBatch(missReqs);
+            }
+            catch (std::exception &e) {
+                // 簇超出卷末尾, 只读取需要的扇区且不缓存.
+                missReqs.clear();
+                for (auto const &m : misses) {
+                    SectorsRequest const &i = reqs[m.req];
+                    uint64_t from = std::max(i.startSecId, m.lcn * spc);
+                    uint64_t to = std::min(i.startSecId + i.secNum,
+                                           (m.lcn + m.num) * spc);
+                    missReqs.emplace_back(
+                        from, to - from,
+                        i.dest + (from - i.startSecId) * GetSectorSize());
+                }
+                ReadBatch(missReqs);
+                return;
+            }
+            off = 0;
+            for (auto const &m : misses) {
+                SectorsRequest const &i = reqs[m.req];
+                for (uint64_t lcn = m.lcn; lcn < m.lcn + m.num; lcn++) {
+                    blockCache->Put(lcn, &buf[0] + off);
+                    CopyClusterOverlap(i.startSecId, i.secNum, i.dest, lcn,
+                                       &buf[0] + off);
+                    off += clusterSize;
+                }
+            }
+        }
+
+    public:
+        // 设置块缓存容量 (单位: 字节), 0 表示关闭缓存.
+        void SetBlockCacheSize(uint64_t bytes) {
+            if (blockCache) blockCache->SetCapacity(bytes);
+        }
 
-        NtfsDataBlock ReadSectors(NtfsSectorsInfo &secs) {
-            std::vector<char> data;
-            uint64_t p = 0, secsSize;
+        BlockCache::Stats GetBlockCacheStats() {
+            if (!blockCache) return BlockCache::Stats{};
+            return blockCache->GetStats();
+        }
+
+        // 从块缓存中丢弃这些扇区所在的簇, 之后重新从磁盘读取. 用于读取活动
+        // 卷上正在改变的数据 (比如 $UsnJrnl).
+        void InvalidateSectors(NtfsSectorsInfo const &secs) {
+            if (!blockCache || !bootInfo.sectorsPerCluster) return;
             for (auto &i : secs) {
-                p = data.size();
-                secsSize = bootInfo.bytesPerSector * i.secNum;
-                data.resize(p + secsSize);
-                if (i.sparse) {
-                    memset(data.data() + p, 0, secsSize);
+                if (i.sparse || !i.secNum) continue;
+                uint64_t beg = i.startSecId / bootInfo.sectorsPerCluster;
+                uint64_t end =
+                    (i.startSecId + i.secNum - 1) / bootInfo.sectorsPerCluster;
+                for (uint64_t lcn = beg; lcn <= end; lcn++) {
+                    blockCache->Invalidate(lcn);
                 }
-                else {
-                    std::vector<char> secsData =
-                        DiskReader::ReadSectors(i.startSecId, i.secNum);
-                    memcpy_s(data.data() + p, secsSize, secsData.data(),
-                             secsData.size());
+            }
+        }
+
+        // 清空块缓存和文件名缓存
+        void ClearCaches() {
+            if (blockCache) blockCache->Clear();
+            if (nameCache) nameCache->Clear();
+        }
+
+        NtfsDataBlock ReadSectors(NtfsSectorsInfo const &secs) {
+            // 内存映射模式下连续的一段直接返回映射的只读视图, 不拷贝数据.
+            if (IsMapped() && secs.size() == 1 && !secs[0].sparse) {
+                std::shared_ptr<char> view =
+                    MapSectors(secs[0].startSecId, secs[0].secNum);
+                if (view) {
+                    return {std::move(view),
+                            (uint64_t)GetSectorSize() * secs[0].secNum, this};
                 }
             }
-            return {data, this};
+            // 一次分配好全部输出, 稀疏段保持为 0 不读取.
+            uint64_t total = 0;
+            for (auto &i : secs) {
+                total += bootInfo.bytesPerSector * i.secNum;
+            }
+            std::vector<char> data(total);
+            std::vector<SectorsRequest> reqs;
+            uint64_t p = 0;
+            for (auto &i : secs) {
+                if (!i.sparse && i.secNum) {
+                    reqs.emplace_back(i.startSecId, i.secNum, &data[0] + p);
+                }
+                p += bootInfo.bytesPerSector * i.secNum;
+            }
+            ReadSectorsCached(reqs);
+            return {std::move(data), this};
         }
 
         uint64_t WriteData(uint64_t off, NtfsDataBlock &data) {
@@ -308,6 +643,11 @@ namespace abkntfs {
                 if (!WriteSector(startingSector, t)) {
                     return writtenSize;
                 }
+                if (blockCache && bootInfo.sectorsPerCluster) {
+                    blockCache->Invalidate(startingSector /
+                                           bootInfo.sectorsPerCluster);
+                }
+                if (nameCache) nameCache->Clear();
                 data = NtfsDataBlock{data, copySize};
                 writtenSize += copySize;
                 if (writtenSize > ss) break;
@@ -326,9 +666,19 @@ namespace abkntfs {
             return *this;
         }
 
-        Ntfs(std::string file) : DiskReader(file), NtfsStructureBase(true) {
+        // mapImage: 以内存映射方式打开镜像文件 (见 DiskReader).
+        Ntfs(std::string file, bool mapImage = false)
+            : DiskReader(file, mapImage), NtfsStructureBase(true) {
             try {
                 bootInfo = ReadSector(0);
+                if (bootInfo.sectorsPerCluster) {
+                    blockCache = std::make_shared<BlockCache>(
+                        (uint64_t)bootInfo.sectorsPerCluster * GetSectorSize(),
+                        IsMapped() ? 0 : DefaultBlockCacheSize);
+                }
+                // make_shared 按引用传参, 传入副本以免 odr-use 静态常量.
+                uint64_t nameCacheEntries = DefaultNameCacheEntries;
+                nameCache = std::make_shared<FileNameCache>(nameCacheEntries);
                 MFT_FileRecord = NtfsFileRecord{
                     NtfsDataBlock{
                         DiskReader::ReadSectors(bootInfo.LCNoVCN0oMFT *
@@ -345,8 +695,10 @@ namespace abkntfs {
                                 *dataAttr.fields.get());
                         FileRecordsCount =
                             nonResidentPart.allocSize / FileRecordSize;
+                        mftExtents = dataAttr.attrData.extents;
                     }
                 }
+                upCase = LoadUpCase();
             }
             catch (std::exception &e) {
                 memset(&bootInfo, 0, sizeof(NtfsBoot));
@@ -394,50 +746,17 @@ namespace abkntfs {
                                                        1);
         }
 
-        // 虚拟扇区号转换到逻辑扇区号
-        NtfsSectorsInfo VSN_To_LSN(NtfsSectorsInfo map, uint64_t index,
+        // 虚拟扇区号转换到逻辑扇区号. 每次都要重建映射, 频繁转换时应使用
+        // NtfsExtentMap.
+        NtfsSectorsInfo VSN_To_LSN(NtfsSectorsInfo const &map, uint64_t index,
                                    uint64_t secNum) {
-            uint64_t remainSecNum = secNum;
-            uint64_t remainIndex = index;
-            NtfsSectorsInfo ret;
-            for (auto &i : map) {
-                NtfsSectors cur = i;
-                if (remainIndex > cur.secNum) {
-                    remainIndex -= cur.secNum;
-                    continue;
-                }
-                cur.startSecId += remainIndex;
-                cur.secNum -= secNum;
-                remainIndex = 0;
-                if (cur.secNum > 0) {
-                    if (cur.secNum >= remainSecNum) {
-                        cur.secNum = remainSecNum;
-                        remainSecNum = 0;
-                        ret.push_back(cur);
-                        return ret;
-                    }
-                    else {
-                        remainSecNum -= cur.secNum;
-                        ret.push_back(cur);
-                    }
-                }
-            }
-            if (remainSecNum) {
-                throw std::runtime_error{"Too many sectors requested!"};
-            }
-            return ret;
+            return NtfsExtentMap{map}.Translate(index, secNum);
         }
 
-        NtfsSectorsInfo GetFileRecordAreaByFRN(uint32_t FRN) {
-            uint32_t secNum = FileRecordSize / bootInfo.bytesPerSector;
-            uint32_t vsn = FRN * secNum;
+        NtfsSectorsInfo GetFileRecordAreaByFRN(uint64_t FRN) {
+            uint64_t secNum = FileRecordSize / bootInfo.bytesPerSector;
             try {
-                NtfsSectorsInfo &availableArea =
-                    MFT_FileRecord.FindSpecAttr(NTFS_DATA, L"")
-                        ->attrData.dataRunsMap;
-                NtfsSectorsInfo requiredArea =
-                    VSN_To_LSN(availableArea, vsn, secNum);
-                return requiredArea;
+                return mftExtents.Translate(FRN * secNum, secNum);
             }
             catch (std::exception &e) {
                 return NtfsSectorsInfo();
@@ -449,6 +768,60 @@ namespace abkntfs {
                                   FRN};
         }
 
+        // 批量读取文件记录, 结果与 FRNs 顺序一致, 无效的记录号对应无效的文件
+        // 记录. 重复的记录号只读取一次, 所有记录按物理位置排序后合并读取.
+        std::vector<NtfsFileRecord>
+        GetFileRecordsByFRN(std::vector<uint64_t> const &FRNs) {
+            std::vector<NtfsFileRecord> ret;
+            std::vector<uint64_t> uniq;
+            for (uint64_t i : FRNs) {
+                if (i < FileRecordsCount) uniq.push_back(i);
+            }
+            std::sort(uniq.begin(), uniq.end());
+            uniq.erase(std::unique(uniq.begin(), uniq.end()), uniq.end());
+            if (uniq.empty()) {
+                ret.resize(FRNs.size());
+                return ret;
+            }
+            std::vector<char> data(uniq.size() * FileRecordSize);
+            std::vector<SectorsRequest> reqs;
+            for (size_t k = 0; k < uniq.size(); k++) {
+                uint64_t p = k * FileRecordSize;
+                for (auto &i : GetFileRecordAreaByFRN(uniq[k])) {
+                    if (!i.sparse) {
+                        reqs.emplace_back(i.startSecId, i.secNum, &data[0] + p);
+                    }
+                    p += i.secNum * bootInfo.bytesPerSector;
+                }
+            }
+            try {
+                ReadSectorsCached(reqs);
+            }
+            catch (std::exception &e) {
+                ret.resize(FRNs.size());
+                return ret;
+            }
+            NtfsDataBlock all{std::move(data), this};
+            std::vector<NtfsFileRecord> records;
+            records.reserve(uniq.size());
+            for (size_t k = 0; k < uniq.size(); k++) {
+                records.emplace_back(
+                    NtfsDataBlock{all, k * FileRecordSize, FileRecordSize},
+                    uniq[k]);
+            }
+            ret.reserve(FRNs.size());
+            for (uint64_t i : FRNs) {
+                auto it = std::lower_bound(uniq.begin(), uniq.end(), i);
+                if (it != uniq.end() && *it == i) {
+                    ret.push_back(records[it - uniq.begin()]);
+                }
+                else {
+                    ret.emplace_back();
+                }
+            }
+            return ret;
+        }
+
         uint64_t GetDataRunsClusterNum(NtfsDataBlock &dataRuns) {
             uint64_t size = 0;
             NtfsSectorsInfo area = DataRunsToSectorsInfo(dataRuns);
@@ -468,32 +841,189 @@ namespace abkntfs {
             return sectorsTotalSize;
         }
 
-        // 获得文件路径
+        // 读取文件记录 FRN 的父目录和文件名 (与 NtfsFileRecord::PickFileName
+        // 一致, 优先选择非 DOS 名字空间的 $FILE_NAME), seq 为引用中的序列号. 优先使用缓存, 未命中时只解析
+        // $FILE_NAME 而不解析整个文件记录. seq 不为 0 且与文件记录的序列号
+        // 不一致 (引用已失效, 记录已被重用) 时返回 false, 也不缓存.
+        bool GetFileNameInfo(uint64_t FRN, uint16_t seq,
+                             FileNameCache::Entry &out) {
+            if (nameCache && nameCache->Get(FRN, seq, out)) {
+                return true;
+            }
+            if (!ReadFileNameInfo(FRN, out)) {
+                return false;
+            }
+            if (seq && out.seq != seq) {
+                return false;
+            }
+            if (nameCache) nameCache->Put(FRN, out);
+            return true;
+        }
+
+        // 卷的大写映射表, 未能读取 $UpCase 时为只转换 ASCII 字母的缺省表.
+        NtfsUpCase const &GetUpCase() const {
+            return upCase ? *upCase : NtfsUpCase::Default();
+        }
+
+        FileNameCache::Stats GetNameCacheStats() {
+            if (!nameCache) return FileNameCache::Stats{};
+            return nameCache->GetStats();
+        }
+
+        // 获得文件所在目录的路径 (以 sep 结尾). 各级目录的路径前缀会被缓存,
+        // 同一目录下的文件共享.
         std::wstring GetFilePath(NtfsFileRecord &fr, std::wstring sep = L"\\") {
-            std::wstring path;
             if (!fr.valid) {
-                return path;
+                return L"";
             }
             AttrData_FILE_NAME *fnAttrData =
                 fr.FindSpecAttrData(NTFS_FILE_NAME);
             if (nullptr == fnAttrData) {
-                return path;
+                return L"";
+            }
+            return GetDirPrefix(fnAttrData->fileInfo.fileRef.fileRecordNum,
+                                fnAttrData->fileInfo.fileRef.seqNum, sep);
+        }
+
+    private:
+        std::shared_ptr<NtfsUpCase> LoadUpCase() {
+            NtfsFileRecord fr = GetFileRecordByFRN(UpCaseFRN);
+            AttrData_DATA *pData = fr.FindSpecAttrData(NTFS_DATA, L"");
+            if (nullptr == pData) {
+                return nullptr;
+            }
+            NtfsDataBlock data = pData->ReadData(0, pData->GetDataSize());
+            if (data.len() < NtfsUpCase::TableEntries * sizeof(uint16_t)) {
+                return nullptr;
+            }
+            return std::make_shared<NtfsUpCase>(data, data.len());
+        }
+
+        // 只解析文件记录中的 $FILE_NAME. 含 $ATTRIBUTE_LIST 的记录文件名可能
+        // 位于扩展记录中, 此时完整解析.
+        bool ReadFileNameInfo(uint64_t FRN, FileNameCache::Entry &out) {
+            NtfsSectorsInfo area = GetFileRecordAreaByFRN(FRN);
+            if (area.empty()) {
+                return false;
+            }
+            std::vector<char> rec;
+            try {
+                rec = ReadSectors(area);
+            }
+            catch (std::exception &e) {
+                return false;
+            }
+            NtfsFileRecord::RecordHeader header;
+            if (rec.size() < sizeof(header)) {
+                return false;
+            }
+            memcpy(&header, rec.data(), sizeof(header));
+            uint64_t usaOff = header.offsetToUS;
+            uint64_t usaNum = header.sizeInWordOfUSN;
+            if (memcmp(header.magicNumber, "FILE", 4) || !usaNum ||
+                usaOff + usaNum * 2 + 2 >= rec.size()) {
+                return false;
             }
-            uint64_t frn = fnAttrData->fileInfo.fileRef.fileRecordNum;
+            // 数据修正
+            uint64_t ss = bootInfo.bytesPerSector;
+            for (uint64_t i = 0; i + 1 < usaNum && ss * (i + 1) <= rec.size();
+                 i++) {
+                memcpy(&rec[ss * i + ss - 2], &rec[usaOff + 2 + i * 2], 2);
+            }
+            uint64_t end = std::min<uint64_t>(header.realSize, rec.size());
+            NtfsAttr::ResidentPart attr;
+            AttrData_FILE_NAME::FileInfo info;
+            bool found = false;
+            for (uint64_t pos = header.offToFirstAttr;
+                 pos + sizeof(NtfsAttr::FixedFields) < end;
+                 pos += attr.length) {
+                memset(&attr, 0, sizeof(attr));
+                memcpy(&attr, &rec[pos],
+                       std::min<uint64_t>(sizeof(attr), rec.size() - pos));
+                if (attr.nonResident > 1 ||
+                    attr.attrType > NTFS_LOGGED_UTILITY_STREAM ||
+                    !attr.length) {
+                    break;
+                }
+                if (attr.attrType == NTFS_ATTRIBUTE_LIST) {
+                    NtfsFileRecord t = GetFileRecordByFRN(FRN);
+                    AttrData_FILE_NAME *pFn = t.PickFileName();
+                    if (!t.valid || nullptr == pFn) {
+                        return false;
+                    }
+                    out = FileNameCache::Entry{
+                        pFn->fileInfo.fileRef.fileRecordNum,
+                        (uint16_t)pFn->fileInfo.fileRef.seqNum,
+                        t.fixedFields.seqNumber, pFn->filename};
+                    return true;
+                }
+                uint64_t off = pos + attr.offToAttr;
+                if (attr.attrType != NTFS_FILE_NAME || attr.nonResident ||
+                    off + sizeof(info) > rec.size()) {
+                    continue;
+                }
+                memcpy(&info, &rec[off], sizeof(info));
+                if (off + sizeof(info) + info.filenameLen * 2 > rec.size()) {
+                    continue;
+                }
+                // 与 NtfsFileRecord::PickFileName 一样, 非 DOS 名字空间的名字
+                // 优先, 只有 8.3 短文件名时使用第一个.
+                bool isDos =
+                    info.nameSpace == AttrData_FILE_NAME::NAME_SPACE_DOS;
+                if (found && isDos) {
+                    continue;
+                }
+                out = FileNameCache::Entry{
+                    info.fileRef.fileRecordNum, (uint16_t)info.fileRef.seqNum,
+                    header.seqNumber,
+                    Utf16ToWString(&rec[off + sizeof(info)], info.filenameLen)};
+                found = true;
+                if (!isDos) {
+                    break;
+                }
+            }
+            return found;
+        }
+
+        // 目录 FRN 下的文件的路径. 中途读取失败或遇到已失效的引用时与原来
+        // 一样只返回已获得的部分 (不以 sep 开头).
+        std::wstring GetDirPrefix(uint64_t FRN, uint16_t seq,
+                                  std::wstring const &sep) {
+            struct Level {
+                uint64_t FRN;
+                uint16_t seq;
+                std::wstring name;
+            };
+            std::vector<Level> levels;
+            std::wstring path;
+            FileNameCache::Entry entry;
+            // 到达根目录或命中缓存的前缀时为 true, 只缓存这样得到的完整前缀.
+            bool complete = false;
             // 文件记录号 5 为根目录(.)
-            while (frn && frn != 5) {
-                NtfsFileRecord t = GetFileRecordByFRN(frn);
-                if (!t.valid) {
-                    return path;
+            while (FRN && FRN != 5) {
+                if (nameCache && nameCache->GetPrefix(FRN, seq, sep, path)) {
+                    complete = true;
+                    break;
+                }
+                if (levels.size() >= MaxPathDepth ||
+                    !GetFileNameInfo(FRN, seq, entry)) {
+                    break;
                 }
-                fnAttrData = t.FindSpecAttrData(NTFS_FILE_NAME);
-                if (nullptr == fnAttrData) {
-                    return path;
+                levels.push_back(Level{FRN, entry.seq, entry.name});
+                FRN = entry.parent;
+                seq = entry.parentSeq;
+            }
+            if (!FRN || FRN == 5) {
+                path = sep;
+                complete = true;
+            }
+            for (auto it = levels.rbegin(); it != levels.rend(); it++) {
+                path += it->name + sep;
+                if (nameCache && complete) {
+                    nameCache->PutPrefix(it->FRN, it->seq, sep, path);
                 }
-                frn = fnAttrData->fileInfo.fileRef.fileRecordNum;
-                path = t.GetFileName() + sep + path;
             }
-            return sep + path;
+            return path;
         }
 
     protected:
@@ -508,6 +1038,10 @@ namespace abkntfs {
             this->MFT_FileRecord = std::move(rr.MFT_FileRecord);
             this->FileRecordsCount = rr.FileRecordsCount;
             this->FileRecordSize = rr.FileRecordSize;
+            this->blockCache = std::move(rr.blockCache);
+            this->mftExtents = std::move(rr.mftExtents);
+            this->nameCache = std::move(rr.nameCache);
+            this->upCase = std::move(rr.upCase);
             return *this;
         }
     };
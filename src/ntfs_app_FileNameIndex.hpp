@@ -17,7 +17,190 @@ namespace abkntfs {
         AttrData_INDEX_ROOT::IndexRootInfo indexInfo;
         // 根节点
         NtfsIndexNode rootNode;
-        std::vector<NtfsIndexRecord> IRs;
+        // 大索引的索引记录, 遍历和查找时按需读取.
+        AttrData_INDEX_ALLOCATION indexAlloc;
+        // 查找时最多下降的层数, 防止损坏的索引出现环.
+        static const uint32_t MaxIndexDepth = 64;
+
+        // 索引项的轻量视图, 直接读取索引记录中的原始数据而不拷贝. 产生它的
+        // 迭代器移动到其他节点后可能失效.
+        struct EntryView {
+            NtfsIndexEntry const *entry = nullptr;
+
+            NtfsFileReference GetFileRef() const {
+                return entry->entryHeader.fileReference;
+            }
+
+            // 流中 $FILE_NAME 的固定部分, 流长度不足时返回 nullptr.
+            AttrData_FILE_NAME::FileInfo const *GetFileInfo() const {
+                if (entry->stream.len() <
+                    sizeof(AttrData_FILE_NAME::FileInfo)) {
+                    return nullptr;
+                }
+                return (AttrData_FILE_NAME::FileInfo const *)
+                    entry->stream.pData;
+            }
+
+            // 文件名 (UTF-16LE, 长度单位为码元), 流长度不足时返回 false.
+            bool GetName(char const *&name, uint64_t &nameLen) const {
+                AttrData_FILE_NAME::FileInfo const *info = GetFileInfo();
+                if (nullptr == info) {
+                    return false;
+                }
+                nameLen = info->filenameLen;
+                if (sizeof(*info) + nameLen * sizeof(char16_t) >
+                    entry->stream.len()) {
+                    return false;
+                }
+                name = entry->stream.pData + sizeof(*info);
+                return true;
+            }
+
+            // 转换为 std::wstring, 需要分配内存.
+            std::wstring GetFileName() const {
+                char const *name;
+                uint64_t nameLen;
+                if (!GetName(name, nameLen)) {
+                    return L"";
+                }
+                return Utf16ToWString(name, nameLen);
+            }
+        };
+
+        // 按文件名顺序遍历索引项的前向迭代器. 只保存从根节点到当前节点路径
+        // 上各层的 (索引记录 VCN, 索引项位置) 及当前节点的索引记录, 回到上层
+        // 时按 VCN 重新取得 (通常命中索引记录缓存), 遍历时不为每个索引项
+        // 分配内存. 读取子节点失败时结束遍历.
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = EntryView;
+            using difference_type = std::ptrdiff_t;
+            using pointer = EntryView const *;
+            using reference = EntryView const &;
+
+            Iterator() = default;
+
+            EntryView const &operator*() const { return view; }
+            EntryView const *operator->() const { return &view; }
+
+            Iterator &operator++() {
+                pos++;
+                ascended = false;
+                Settle();
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator ret = *this;
+                ++*this;
+                return ret;
+            }
+
+            bool operator==(Iterator const &r) const {
+                return index == r.index && node == r.node && pos == r.pos;
+            }
+            bool operator!=(Iterator const &r) const { return !(*this == r); }
+
+            // 当前节点的深度, 根节点为 0.
+            uint64_t Depth() const { return trace.size(); }
+
+        private:
+            friend struct NtfsFileNameIndex;
+            // 根节点不在索引记录中, 用此 VCN 表示.
+            static const uint64_t RootVCN = (uint64_t)-1;
+
+            // 结束时为空
+            NtfsFileNameIndex *index = nullptr;
+            std::vector<std::pair<uint64_t, uint64_t>> trace;
+            std::shared_ptr<NtfsIndexRecord> holder;
+            NtfsIndexNode const *node = nullptr;
+            uint64_t vcn = RootVCN;
+            uint64_t pos = 0;
+            // 当前项指向的子节点已遍历完
+            bool ascended = false;
+            EntryView view;
+
+            explicit Iterator(NtfsFileNameIndex *index)
+                : index(index), node(&index->rootNode) {
+                Settle();
+            }
+
+            void SetEnd() {
+                index = nullptr;
+                node = nullptr;
+                pos = 0;
+                holder.reset();
+                trace.clear();
+            }
+
+            bool Load(uint64_t VCN) {
+                vcn = VCN;
+                if (VCN == RootVCN) {
+                    holder.reset();
+                    node = &index->rootNode;
+                    return true;
+                }
+                holder = index->indexAlloc.GetIRByVCN(VCN);
+                if (!holder) return false;
+                node = &holder->node;
+                return true;
+            }
+
+            // 从当前位置前进到下一个有键的索引项 (中序).
+            void Settle() {
+                while (true) {
+                    if (pos < node->IEs.size()) {
+                        NtfsIndexEntry const &entry = node->IEs[pos];
+                        if (!ascended &&
+                            (entry.entryHeader.flags &
+                             NtfsIndexEntry::FLAG_IE_POINT_TO_SUBNODE)) {
+                            // 损坏的索引可能成环
+                            if (trace.size() >= MaxIndexDepth) break;
+                            trace.emplace_back(vcn, pos);
+                            if (!Load(entry.pIndexRecordNumber)) break;
+                            pos = 0;
+                            continue;
+                        }
+                        ascended = false;
+                        if (entry.entryHeader.flags &
+                            NtfsIndexEntry::FLAG_LAST_ENTRY_IN_THE_NODE) {
+                            pos++;
+                            continue;
+                        }
+                        view.entry = &entry;
+                        return;
+                    }
+                    if (trace.empty()) break;
+                    pos = trace.back().second;
+                    uint64_t up = trace.back().first;
+                    trace.pop_back();
+                    if (!Load(up)) break;
+                    ascended = true;
+                }
+                SetEnd();
+            }
+        };
+
+    private:
+        // 用于取得卷的 $UpCase
+        Ntfs *pNtfs = nullptr;
+
+        // 查找中的当前节点, 以及持有该节点的索引记录 (根节点为空).
+        struct NodePos {
+            std::shared_ptr<NtfsIndexRecord> holder;
+            NtfsIndexNode const *node;
+            uint64_t i;
+        };
+
+        // 读取索引项指向的子节点, 失败返回 false.
+        bool LoadSubNode(NtfsIndexEntry const &entry, NodePos &pos) {
+            pos.holder = indexAlloc.GetIRByVCN(entry.pIndexRecordNumber);
+            if (!pos.holder) return false;
+            pos.node = &pos.holder->node;
+            pos.i = 0;
+            return true;
+        }
 
     public:
         NtfsFileNameIndex() = default;
@@ -41,6 +224,8 @@ namespace abkntfs {
                 Reset();
                 return;
             }
+            this->pNtfs = fileRecord.FindSpecAttr(NTFS_INDEX_ROOT, L"$I30")
+                              ->rawData.pNtfs;
             this->indexInfo = indexRootAttrData->rootInfo;
             this->rootNode = indexRootAttrData->rootNode;
             if (rootNode.nodeHeader.notLeafNode) {
@@ -50,117 +235,79 @@ namespace abkntfs {
                     Reset();
                     return;
                 }
-                this->IRs = indexAllocationData->GetIRs();
+                this->indexAlloc = *indexAllocationData;
             }
         }
 
-        // 遍历文件信息.
+        Iterator begin() { return Iterator{this}; }
+        Iterator end() { return Iterator{}; }
+
+        // 遍历文件信息, 每个索引项都会构造 AttrData_FILE_NAME; 只需要文件名
+        // 或文件引用时使用迭代器.
         void ForEachFileInfo(
             std::function<bool(FileInfoInIndex fileInfo)> callback) {
-            std::stack<NtfsIndexNode> nodeTrace;
-            std::stack<uint64_t> iterationTrace;
-            NtfsIndexNode curNode = rootNode;
-            uint64_t curIteration = 0;
-            while (true) {
-                if (curIteration < curNode.IEs.size()) {
-                    NtfsIndexEntry &curEntry = curNode.IEs[curIteration];
-                    if (curEntry.entryHeader.flags &
-                        NtfsIndexEntry::FLAG_IE_POINT_TO_SUBNODE) {
-                        nodeTrace.push(curNode);
-                        iterationTrace.push(curIteration);
-                        if (curEntry.pIndexRecordNumber >= IRs.size()) break;
-                        curNode = IRs[curEntry.pIndexRecordNumber].node;
-                        curIteration = 0;
-                        continue;
-                    }
-                    curIteration++;
-                    if (curEntry.entryHeader.flags &
-                        NtfsIndexEntry::FLAG_LAST_ENTRY_IN_THE_NODE) {
-                        continue;
-                    }
-                    if (!callback(FileInfoInIndex{
-                            AttrData_FILE_NAME{curEntry.stream},
-                            curEntry.entryHeader.fileReference})) {
-                        break;
-                    }
-                    continue;
-                }
-                if (!nodeTrace.empty()) {
-                    curNode = nodeTrace.top();
-                    curIteration = iterationTrace.top();
-                    nodeTrace.pop();
-                    iterationTrace.pop();
-                    NtfsIndexEntry &curEntry = curNode.IEs[curIteration];
-                    if (curEntry.stream.len()) {
-                        if (!callback(FileInfoInIndex{
-                                AttrData_FILE_NAME{curEntry.stream},
-                                curEntry.entryHeader.fileReference})) {
-                            break;
-                        }
-                    }
-                    curIteration++;
-                    continue;
+            for (EntryView const &entry : *this) {
+                if (!callback(
+                        FileInfoInIndex{AttrData_FILE_NAME{entry.entry->stream},
+                                        entry.GetFileRef()})) {
+                    break;
                 }
-                break;
             }
         }
 
-        // 根据文件名查找文件
+        // 根据文件名查找文件 (按 $UpCase 不区分大小写). 在每个节点内按排序
+        // 规则二分查找, 只读取从根节点到目标节点路径上的索引记录.
         FileInfoInIndex FindFile(std::wstring filename) {
-            std::stack<NtfsIndexNode> nodeTrace;
-            std::stack<uint64_t> iterationTrace;
-            NtfsIndexNode curNode = rootNode;
-            uint64_t curIteration = curNode.IEs.size() - 1;
-            while (true) {
-                NtfsIndexEntry &curEntry = curNode.IEs[curIteration];
-                if (curEntry.entryHeader.flags &
-                    NtfsIndexEntry::FLAG_IE_POINT_TO_SUBNODE) {
-                    AttrData_FILE_NAME curFilename(curEntry.stream);
+            std::u16string target = WStringToUtf16(filename);
+            NtfsUpCase const &upCase =
+                pNtfs ? pNtfs->GetUpCase() : NtfsUpCase::Default();
+            NodePos cur{nullptr, &rootNode, 0};
+            for (uint32_t depth = 0; depth < MaxIndexDepth; depth++) {
+                std::vector<NtfsIndexEntry> const &IEs = cur.node->IEs;
+                if (IEs.empty()) {
+                    break;
+                }
+                // 结束项没有键, 不参与比较.
+                uint64_t lo = 0;
+                uint64_t hi = IEs.size();
+                if (IEs.back().entryHeader.flags &
+                    NtfsIndexEntry::FLAG_LAST_ENTRY_IN_THE_NODE) {
+                    hi--;
+                }
+                while (lo < hi) {
+                    uint64_t mid = lo + (hi - lo) / 2;
+                    NtfsIndexEntry const &entry = IEs[mid];
+                    char const *name;
+                    uint64_t nameLen;
                     // 不正常
-                    if (!curFilename.valid) {
-                        break;
+                    if (!EntryView{&entry}.GetName(name, nameLen)) {
+                        return FileInfoInIndex();
                     }
-                    int cmp = filename.compare(curFilename.filename);
+                    int cmp = upCase.Compare(
+                        name, nameLen, (char const *)target.data(),
+                        target.size());
                     if (cmp == 0) {
                         return FileInfoInIndex{
-                            curFilename, curEntry.entryHeader.fileReference};
+                            AttrData_FILE_NAME{entry.stream},
+                            entry.entryHeader.fileReference};
                     }
-                    if (cmp > 0) {
-                        if (curIteration) {
-                            curIteration--;
-                            continue;
-                        }
-                        break;
+                    if (cmp < 0) {
+                        lo = mid + 1;
                     }
-                    nodeTrace.push(curNode);
-                    iterationTrace.push(curIteration);
-                    if (curEntry.pIndexRecordNumber >= IRs.size()) break;
-                    curNode = IRs[curEntry.pIndexRecordNumber].node;
-                    curIteration = curNode.IEs.size() - 1;
-                    continue;
-                }
-                if (curEntry.entryHeader.flags &
-                    NtfsIndexEntry::FLAG_LAST_ENTRY_IN_THE_NODE) {
-                    if (curIteration) {
-                        curIteration--;
-                        continue;
+                    else {
+                        hi = mid;
                     }
-                    break;
                 }
-                AttrData_FILE_NAME curFilename(curEntry.stream);
-                // 不正常
-                if (!curFilename.valid) {
+                // lo 为第一个排在目标之后的项 (或结束项), 目标只可能在它的
+                // 子节点中.
+                if (lo >= IEs.size() ||
+                    !(IEs[lo].entryHeader.flags &
+                      NtfsIndexEntry::FLAG_IE_POINT_TO_SUBNODE)) {
                     break;
                 }
-                if (filename.compare(curFilename.filename) == 0) {
-                    return FileInfoInIndex{curFilename,
-                                           curEntry.entryHeader.fileReference};
-                }
-                if (curIteration) {
-                    curIteration--;
-                    continue;
+                if (!LoadSubNode(IEs[lo], cur)) {
+                    break;
                 }
-                break;
             }
             return FileInfoInIndex();
         }
@@ -171,7 +318,8 @@ namespace abkntfs {
             T const &rr = (T const &)r;
             this->indexInfo = rr.indexInfo;
             this->rootNode = rr.rootNode;
-            this->IRs = rr.IRs;
+            this->indexAlloc = rr.indexAlloc;
+            this->pNtfs = rr.pNtfs;
             return *this;
         }
         virtual NtfsFileNameIndex &Move(NtfsStructureBase &r) override {
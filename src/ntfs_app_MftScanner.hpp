@@ -0,0 +1,428 @@
+#pragma once
+#include "ntfs_access.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace abkntfs {
+    // 顺序扫描整个 MFT. 沿 $MFT 的 $DATA data runs 以大块连续读取 (绕过块
+    // 缓存), 在读取的缓冲区上原地进行数据修正, 文件记录直接引用该缓冲区.
+    // 默认按 $MFT:$BITMAP 跳过未使用的文件记录, 不读取也不解析.
+    struct NtfsMftScanner : NtfsStructureBase {
+        // 每次读取的默认大小 (单位: 字节)
+        static const uint64_t DefaultChunkSize = 4ull << 20;
+
+        struct ScanStats {
+            // 有效的文件记录数
+            uint64_t records;
+            // 读取的字节数
+            uint64_t bytes;
+            // 单位: 秒
+            double seconds;
+            // 下一个未处理的文件记录号
+            uint64_t nextFRN;
+
+            double RecordsPerSecond() const {
+                return seconds > 0 ? records / seconds : 0;
+            }
+            double MBPerSecond() const {
+                return seconds > 0 ? bytes / seconds / (1 << 20) : 0;
+            }
+        };
+
+    private:
+        Ntfs *pNtfs = nullptr;
+        // $MFT:$DATA 的扇区分布
+        NtfsExtentMap mftExtents;
+        uint64_t chunkSize = DefaultChunkSize;
+        // 下一个要返回的文件记录号
+        uint64_t nextFRN = 0;
+        // 已读取的块及其包含的文件记录号范围 [chunkBeg, chunkEnd)
+        NtfsDataBlock chunk;
+        uint64_t chunkBeg = 0;
+        uint64_t chunkEnd = 0;
+        // $MFT:$BITMAP, 无效时认为所有文件记录都在使用中.
+        TypeData_BITMAP mftBitmap;
+        // 是否包含未使用的文件记录 (用于恢复数据)
+        bool includeFree = false;
+        // 顺序扫描已读取的字节数
+        uint64_t bytesRead = 0;
+
+        // 返回 [FRN, end) 中第一个需要读取的文件记录号, 没有则返回 end.
+        uint64_t NextWanted(uint64_t FRN, uint64_t end) const {
+            if (includeFree || !mftBitmap.valid ||
+                FRN >= mftBitmap.bitmap.len() * 8) {
+                return std::min(FRN, end);
+            }
+            uint64_t ret = mftBitmap.FindUsedUnitPos(FRN);
+            // 位图之外的部分当作使用中
+            if (ret == (uint64_t)-1) {
+                ret = mftBitmap.bitmap.len() * 8;
+            }
+            return std::min(ret, end);
+        }
+
+        // 返回 [FRN, end) 中第一个不需要读取的文件记录号, 没有则返回 end.
+        uint64_t NextUnwanted(uint64_t FRN, uint64_t end) const {
+            if (includeFree || !mftBitmap.valid) {
+                return end;
+            }
+            while (FRN < end && FRN < mftBitmap.bitmap.len() * 8 &&
+                   (mftBitmap.bitmap[FRN / 8] & (1 << (FRN % 8)))) {
+                FRN++;
+            }
+            return FRN < mftBitmap.bitmap.len() * 8 ? FRN : end;
+        }
+
+        // 把 [FRN, FRN + num) 的文件记录转换为扇区分布
+        NtfsSectorsInfo GetRecordsArea(uint64_t FRN, uint64_t num) {
+            uint64_t secPerRecord =
+                pNtfs->FileRecordSize / pNtfs->bootInfo.bytesPerSector;
+            return mftExtents.Translate(FRN * secPerRecord,
+                                        num * secPerRecord);
+        }
+
+        // 每块包含的文件记录数
+        uint64_t RecordsPerChunk() const {
+            return std::max<uint64_t>(1, chunkSize / pNtfs->FileRecordSize);
+        }
+
+        // 读取 [FRN, FRN + num) 中需要的文件记录到 out (不需要的位置为 0,
+        // 全都不需要时 out 为空), bytes 为实际读取的字节数. 失败返回 false.
+        bool ReadRecords(uint64_t FRN, uint64_t num, NtfsDataBlock &out,
+                         uint64_t &bytes) {
+            uint64_t recordSize = pNtfs->FileRecordSize;
+            uint64_t end = FRN + num;
+            bytes = 0;
+            try {
+                std::vector<char> data;
+                std::vector<SectorsRequest> reqs;
+                uint64_t beg = NextWanted(FRN, end);
+                while (beg < end) {
+                    uint64_t stop = NextUnwanted(beg, end);
+                    if (data.empty()) data.resize(num * recordSize);
+                    uint64_t p = (beg - FRN) * recordSize;
+                    for (auto &i : GetRecordsArea(beg, stop - beg)) {
+                        if (!i.sparse) {
+                            reqs.emplace_back(i.startSecId, i.secNum,
+                                              &data[0] + p);
+                            bytes += i.secNum * pNtfs->bootInfo.bytesPerSector;
+                        }
+                        p += i.secNum * pNtfs->bootInfo.bytesPerSector;
+                    }
+                    beg = NextWanted(stop, end);
+                }
+                pNtfs->ReadBatch(reqs);
+                out = data.empty() ? NtfsDataBlock{}
+                                   : NtfsDataBlock{std::move(data), pNtfs};
+            }
+            catch (std::exception &e) {
+                return false;
+            }
+            return true;
+        }
+
+        // 读取从 FRN 开始的一块文件记录, 失败返回 false.
+        bool LoadChunk(uint64_t FRN) {
+            uint64_t num = std::min<uint64_t>(RecordsPerChunk(),
+                                              pNtfs->FileRecordsCount - FRN);
+            uint64_t bytes = 0;
+            if (!ReadRecords(FRN, num, chunk, bytes)) {
+                chunk = NtfsDataBlock{};
+                chunkBeg = chunkEnd = 0;
+                return false;
+            }
+            bytesRead += bytes;
+            chunkBeg = FRN;
+            chunkEnd = FRN + num;
+            return true;
+        }
+
+    public:
+        NtfsMftScanner() = default;
+        NtfsMftScanner(NtfsMftScanner const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsMftScanner &operator=(NtfsMftScanner const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
+
+        // chunkSize: 每次读取的大小 (单位: 字节); includeFree: 是否包含
+        // $MFT:$BITMAP 中未使用的文件记录.
+        NtfsMftScanner(Ntfs &disk, uint64_t chunkSize = DefaultChunkSize,
+                       bool includeFree = false)
+            : NtfsStructureBase(true), pNtfs(&disk), chunkSize(chunkSize),
+              includeFree(includeFree) {
+            if (!disk.valid || !disk.FileRecordSize) {
+                Reset();
+                return;
+            }
+            AttrData_DATA *pData =
+                disk.MFT_FileRecord.FindSpecAttrData(NTFS_DATA, L"");
+            if (nullptr == pData) {
+                Reset();
+                return;
+            }
+            mftExtents = pData->extents;
+            NtfsAttr *pBitmap = disk.MFT_FileRecord.FindSpecAttr(NTFS_BITMAP);
+            if (nullptr != pBitmap && !includeFree) {
+                mftBitmap = TypeData_BITMAP{
+                    pBitmap->ReadAttrRawRealData(0, pBitmap->GetDataSize(),
+                                                 &disk),
+                    TypeData_BITMAP::UNIT_RECORD};
+            }
+        }
+
+        // 顺序扫描 (Next, ForEachFileRecord) 已读取的字节数
+        uint64_t GetBytesRead() const { return bytesRead; }
+
+        // 下一个要返回的文件记录号, 可用于之后从此处继续扫描.
+        uint64_t Tell() const { return nextFRN; }
+
+        void Seek(uint64_t FRN) { nextFRN = FRN; }
+
+        // 按文件记录号顺序取得下一个有效的文件记录, 扫描结束或读取失败返回
+        // false (读取失败时 Tell() 为出错的文件记录号).
+        bool Next(NtfsFileRecord &record) {
+            if (!valid) {
+                return false;
+            }
+            while (true) {
+                nextFRN = NextWanted(nextFRN, pNtfs->FileRecordsCount);
+                if (nextFRN >= pNtfs->FileRecordsCount) break;
+                if (nextFRN < chunkBeg || nextFRN >= chunkEnd) {
+                    if (!LoadChunk(nextFRN)) {
+                        return false;
+                    }
+                }
+                uint64_t FRN = nextFRN;
+                NtfsFileRecord t{NtfsDataBlock{chunk,
+                                               (FRN - chunkBeg) *
+                                                   pNtfs->FileRecordSize,
+                                               pNtfs->FileRecordSize},
+                                 FRN};
+                nextFRN++;
+                if (t.valid) {
+                    record = std::move(t);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // 从 startFRN 开始遍历有效的文件记录, callback 返回 false 时停止.
+        // 返回下一个未处理的文件记录号.
+        uint64_t ForEachFileRecord(
+            std::function<bool(NtfsFileRecord &record)> callback,
+            uint64_t startFRN = 0) {
+            NtfsFileRecord record;
+            Seek(startFRN);
+            while (Next(record)) {
+                if (!callback(record)) {
+                    break;
+                }
+            }
+            return nextFRN;
+        }
+
+        // 并行扫描: 一个线程顺序读取, workers 个线程解析 (0 表示按 CPU
+        // 核数), 已读取未交付的块最多 2 * workers 个. callback 总在调用者
+        // 线程中执行; ordered 为 true 时按文件记录号顺序交付, 否则按解析
+        // 完成的顺序交付 (此时提前停止后从 nextFRN 继续可能重复交付一部分).
+        ScanStats ParallelForEachFileRecord(
+            std::function<bool(NtfsFileRecord &record)> callback,
+            uint32_t workers = 0, bool ordered = true, uint64_t startFRN = 0) {
+            struct Batch {
+                uint64_t seq;
+                uint64_t beg;
+                uint64_t num;
+                // 实际读取的字节数
+                uint64_t bytes;
+                NtfsDataBlock data;
+                std::vector<NtfsFileRecord> records;
+            };
+            ScanStats stats = {0, 0, 0, startFRN};
+            if (!valid || startFRN >= pNtfs->FileRecordsCount) {
+                return stats;
+            }
+            if (workers == 0) {
+                workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+            auto beg = std::chrono::steady_clock::now();
+            uint64_t perChunk = RecordsPerChunk();
+            uint64_t recordSize = pNtfs->FileRecordSize;
+            uint64_t chunks =
+                (pNtfs->FileRecordsCount - startFRN + perChunk - 1) / perChunk;
+            uint64_t ringSize = 2ull * workers;
+
+            std::mutex lock;
+            std::condition_variable readCv, parseCv, doneCv;
+            std::deque<std::shared_ptr<Batch>> toParse;
+            std::map<uint64_t, std::shared_ptr<Batch>> parsed;
+            // 已读取未交付的块数
+            uint64_t inFlight = 0;
+            // 成功读取的块数
+            uint64_t readCount = 0;
+            uint64_t readFailFRN = pNtfs->FileRecordsCount;
+            bool readDone = false, stop = false;
+
+            std::thread reader([&] {
+                for (uint64_t seq = 0; seq < chunks; seq++) {
+                    {
+                        std::unique_lock<std::mutex> l(lock);
+                        readCv.wait(l, [&] {
+                            return stop || inFlight < ringSize;
+                        });
+                        if (stop) break;
+                        inFlight++;
+                    }
+                    auto batch = std::make_shared<Batch>();
+                    batch->seq = seq;
+                    batch->beg = startFRN + seq * perChunk;
+                    batch->num = std::min(perChunk,
+                                          pNtfs->FileRecordsCount - batch->beg);
+                    bool ok = ReadRecords(batch->beg, batch->num, batch->data,
+                                          batch->bytes);
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!ok) {
+                        inFlight--;
+                        readFailFRN = batch->beg;
+                        break;
+                    }
+                    readCount++;
+                    toParse.push_back(batch);
+                    parseCv.notify_one();
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                readDone = true;
+                parseCv.notify_all();
+                doneCv.notify_all();
+            });
+            std::vector<std::thread> parsers;
+            for (uint32_t i = 0; i < workers; i++) {
+                parsers.emplace_back([&] {
+                    while (true) {
+                        std::shared_ptr<Batch> batch;
+                        {
+                            std::unique_lock<std::mutex> l(lock);
+                            parseCv.wait(l, [&] {
+                                return stop || readDone || !toParse.empty();
+                            });
+                            if (stop || toParse.empty()) return;
+                            batch = toParse.front();
+                            toParse.pop_front();
+                        }
+                        uint64_t end =
+                            batch->beg + (batch->data.len() ? batch->num : 0);
+                        uint64_t FRN = NextWanted(batch->beg, end);
+                        while (FRN < end) {
+                            NtfsFileRecord t{
+                                NtfsDataBlock{batch->data,
+                                              (FRN - batch->beg) * recordSize,
+                                              recordSize},
+                                FRN};
+                            if (t.valid) {
+                                batch->records.push_back(std::move(t));
+                            }
+                            FRN = NextWanted(FRN + 1, end);
+                        }
+                        std::lock_guard<std::mutex> guard(lock);
+                        parsed[batch->seq] = batch;
+                        doneCv.notify_one();
+                    }
+                });
+            }
+
+            // 各块是否已交付, 用于计算继续扫描的位置
+            std::vector<bool> delivered(chunks);
+            uint64_t nextSeq = 0, deliveredCount = 0;
+            uint64_t stopSeq = chunks, stopFRN = 0;
+            while (true) {
+                std::shared_ptr<Batch> batch;
+                {
+                    std::unique_lock<std::mutex> l(lock);
+                    doneCv.wait(l, [&] {
+                        return (ordered ? parsed.count(nextSeq) != 0
+                                        : !parsed.empty()) ||
+                               (readDone && deliveredCount == readCount);
+                    });
+                    if (parsed.empty() ||
+                        (ordered && !parsed.count(nextSeq))) {
+                        break;
+                    }
+                    auto it = ordered ? parsed.find(nextSeq) : parsed.begin();
+                    batch = it->second;
+                    parsed.erase(it);
+                }
+                nextSeq++;
+                for (auto &i : batch->records) {
+                    stats.records++;
+                    if (!callback(i)) {
+                        stopSeq = batch->seq;
+                        stopFRN = i.FRN + 1;
+                        break;
+                    }
+                }
+                stats.bytes += batch->bytes;
+                delivered[batch->seq] = true;
+                deliveredCount++;
+                std::lock_guard<std::mutex> guard(lock);
+                inFlight--;
+                readCv.notify_one();
+                if (stopSeq != chunks) {
+                    stop = true;
+                    break;
+                }
+            }
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                stop = true;
+            }
+            readCv.notify_all();
+            parseCv.notify_all();
+            reader.join();
+            for (auto &i : parsers) {
+                i.join();
+            }
+
+            stats.nextFRN = stopSeq != chunks ? stopFRN : readFailFRN;
+            for (uint64_t i = 0; i < chunks; i++) {
+                if (!delivered[i] || i == stopSeq) {
+                    stats.nextFRN = std::min(
+                        stats.nextFRN, i == stopSeq ? stopFRN
+                                                    : startFRN + i * perChunk);
+                    break;
+                }
+            }
+            stats.seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - beg)
+                                .count();
+            return stats;
+        }
+
+    protected:
+        virtual NtfsMftScanner &Copy(NtfsStructureBase const &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T const &rr = (T const &)r;
+            this->pNtfs = rr.pNtfs;
+            this->mftExtents = rr.mftExtents;
+            this->chunkSize = rr.chunkSize;
+            this->nextFRN = rr.nextFRN;
+            this->chunk = rr.chunk;
+            this->chunkBeg = rr.chunkBeg;
+            this->chunkEnd = rr.chunkEnd;
+            this->mftBitmap = rr.mftBitmap;
+            this->includeFree = rr.includeFree;
+            this->bytesRead = rr.bytesRead;
+            return *this;
+        }
+        virtual NtfsMftScanner &Move(NtfsStructureBase &r) override {
+            return Copy(r);
+        }
+    };
+}
@@ -0,0 +1,481 @@
+#pragma once
+#include "ntfs_access.hpp"
+#include "ntfs_app_MftScanner.hpp"
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <unordered_set>
+
+namespace abkntfs {
+    // 整个卷的路径表. 一次扫描 MFT, 收集每个文件记录的 (父目录, 文件名,
+    // 名字空间) 存入以文件记录号为下标的数组, 文件名去重后存放在字符串池中.
+    // 路径在内存中计算, 不再读取磁盘. 另外以 CSR (compressed sparse row)
+    // 形式保存父目录到子节点的索引, 列出目录不需要读取 $I30. 每个文件只记录
+    // 一个父目录, 硬链接只出现在其中一个目录下.
+    struct NtfsPathTable : NtfsStructureBase {
+        // 没有文件名的文件记录的父目录
+        static const uint32_t NoEntry = 0xFFFFFFFF;
+        // 根目录的文件记录号
+        static const uint32_t RootFRN = 5;
+
+        // 文件格式版本
+        static const uint32_t FileVersion = 2;
+
+        struct BuildStats {
+            // 有文件名的文件记录数
+            uint64_t entries;
+            // 去重后的文件名数
+            uint64_t names;
+            // MFT 扫描的统计
+            NtfsMftScanner::ScanStats scan;
+        };
+
+    private:
+#pragma pack(push, 1)
+        struct FileHeader {
+            // "ABKPATH"
+            char magic[8];
+            uint32_t version;
+            uint32_t recordsCount;
+            uint64_t volumeSerial;
+            uint64_t entries;
+            uint64_t names;
+            uint64_t childrenCount;
+        };
+#pragma pack(pop)
+
+        // 以下数组以文件记录号为下标
+        std::vector<uint32_t> parents;
+        std::vector<uint32_t> nameIds;
+        std::vector<uint8_t> nameSpaces;
+        // 所有去重的文件名 (UTF-16, 与磁盘上和保存的文件中相同) 首尾相接,
+        // 第 i 个文件名为 [nameOffs[i], nameOffs[i + 1]).
+        std::u16string pool;
+        std::vector<uint32_t> nameOffs;
+        // 目录 i 的子节点为 children[childBeg[i], childBeg[i + 1]), 按卷的
+        // 文件名排序规则排序 (与 $I30 的顺序相同).
+        std::vector<uint32_t> childBeg;
+        std::vector<uint32_t> children;
+        // 所属卷的序列号, 加载时校验
+        uint64_t volumeSerial = 0;
+        // 所属卷的大写映射表, 用于排序和查找子节点
+        NtfsUpCase upCase;
+        BuildStats buildStats = {};
+
+        bool HasEntry(uint64_t FRN) const {
+            return FRN < parents.size() && parents[FRN] != NoEntry;
+        }
+
+        void AppendName(std::wstring &path, uint64_t FRN) const {
+            uint32_t id = nameIds[FRN];
+            path += Utf16ToWString((char const *)(pool.data() + nameOffs[id]),
+                                   nameOffs[id + 1] - nameOffs[id]);
+        }
+
+        int CompareName(uint64_t FRN, char16_t const *name,
+                        uint64_t len) const {
+            uint32_t id = nameIds[FRN];
+            return upCase.Compare(pool.data() + nameOffs[id],
+                                  nameOffs[id + 1] - nameOffs[id], name, len);
+        }
+
+        // 以文件名在 pool 中的编号为键去重, 散列和比较都直接使用 pool 中的
+        // 名字, 不另外保存一份.
+        struct NameIdHash {
+            NtfsPathTable const *table;
+            size_t operator()(uint32_t id) const {
+                // FNV-1a
+                uint64_t h = 14695981039346656037ULL;
+                for (uint32_t i = table->nameOffs[id];
+                     i < table->nameOffs[id + 1]; i++) {
+                    h = (h ^ table->pool[i]) * 1099511628211ULL;
+                }
+                return (size_t)h;
+            }
+        };
+        struct NameIdEqual {
+            NtfsPathTable const *table;
+            bool operator()(uint32_t a, uint32_t b) const {
+                auto const &offs = table->nameOffs;
+                return offs[a + 1] - offs[a] == offs[b + 1] - offs[b] &&
+                       std::equal(table->pool.begin() + offs[a],
+                                  table->pool.begin() + offs[a + 1],
+                                  table->pool.begin() + offs[b]);
+            }
+        };
+
+        // 按父目录对文件记录计数排序得到 CSR 索引. 根目录不作为自己的子节点.
+        void BuildChildren() {
+            uint64_t n = parents.size();
+            childBeg.assign(n + 1, 0);
+            for (uint64_t i = 0; i < n; i++) {
+                if (i != RootFRN && HasEntry(i) && parents[i] < n) {
+                    childBeg[parents[i] + 1]++;
+                }
+            }
+            for (uint64_t i = 0; i < n; i++) {
+                childBeg[i + 1] += childBeg[i];
+            }
+            children.assign(childBeg[n], 0);
+            std::vector<uint32_t> fill(childBeg.begin(), childBeg.end() - 1);
+            for (uint64_t i = 0; i < n; i++) {
+                if (i != RootFRN && HasEntry(i) && parents[i] < n) {
+                    children[fill[parents[i]]++] = (uint32_t)i;
+                }
+            }
+            auto less = [&](uint32_t a, uint32_t b) {
+                uint32_t id = nameIds[b];
+                return CompareName(a, pool.data() + nameOffs[id],
+                                   nameOffs[id + 1] - nameOffs[id]) < 0;
+            };
+            for (uint64_t i = 0; i < n; i++) {
+                std::sort(children.begin() + childBeg[i],
+                          children.begin() + childBeg[i + 1], less);
+            }
+        }
+
+        template <typename T>
+        static void WriteArray(std::ostream &out, std::vector<T> const &v) {
+            if (v.empty()) return;
+            out.write((char const *)v.data(), v.size() * sizeof(T));
+        }
+
+        template <typename T>
+        static bool ReadArray(std::istream &in, std::vector<T> &v, uint64_t n) {
+            v.resize(n);
+            if (!n) return true;
+            in.read((char *)v.data(), n * sizeof(T));
+            return (bool)in;
+        }
+
+    public:
+        NtfsPathTable() = default;
+        NtfsPathTable(NtfsPathTable const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsPathTable &operator=(NtfsPathTable const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
+
+        // 扫描整个 MFT 建立路径表, workers 为并行解析的线程数 (0 表示按
+        // CPU 核数). 扫描中途失败时 valid 为 false.
+        NtfsPathTable(Ntfs &disk, uint32_t workers = 0)
+            : NtfsStructureBase(true) {
+            NtfsMftScanner scanner{disk};
+            if (!scanner.valid) {
+                Reset();
+                return;
+            }
+            volumeSerial = disk.bootInfo.volumeSerialNumber;
+            upCase = disk.GetUpCase();
+            parents.assign(disk.FileRecordsCount, (uint32_t)NoEntry);
+            nameIds.assign(disk.FileRecordsCount, 0);
+            nameSpaces.assign(disk.FileRecordsCount, 0);
+            nameOffs.push_back(0);
+            std::unordered_set<uint32_t, NameIdHash, NameIdEqual> ids(
+                1024, NameIdHash{this}, NameIdEqual{this});
+            auto callback = [&](NtfsFileRecord &record) {
+                // 跳过未使用的和扩展文件记录, 扩展文件记录的属性已合并到
+                // 基文件记录.
+                if (!(record.fixedFields.flags &
+                      NtfsFileRecord::FILE_RECORD_IN_USE) ||
+                    record.fixedFields.fileReference.fileRecordNum ||
+                    record.FRN >= parents.size()) {
+                    return true;
+                }
+                AttrData_FILE_NAME *fn = record.PickFileName();
+                if (nullptr == fn) return true;
+                // 先把名字追加到 pool 末尾作为新的编号, 已存在时撤销.
+                uint32_t id = (uint32_t)(nameOffs.size() - 1);
+                pool += WStringToUtf16(fn->filename);
+                nameOffs.push_back((uint32_t)pool.size());
+                auto ins = ids.insert(id);
+                if (!ins.second) {
+                    nameOffs.pop_back();
+                    pool.resize(nameOffs.back());
+                }
+                uint64_t parent = fn->fileInfo.fileRef.fileRecordNum;
+                parents[record.FRN] =
+                    parent < NoEntry ? (uint32_t)parent : NoEntry - 1;
+                nameIds[record.FRN] = *ins.first;
+                nameSpaces[record.FRN] = fn->fileInfo.nameSpace;
+                buildStats.entries++;
+                return true;
+            };
+            buildStats.scan =
+                scanner.ParallelForEachFileRecord(callback, workers, false);
+            buildStats.names = ids.size();
+            pool.shrink_to_fit();
+            nameOffs.shrink_to_fit();
+            if (buildStats.scan.nextFRN < disk.FileRecordsCount) {
+                Reset();
+                return;
+            }
+            BuildChildren();
+        }
+
+        // 从 Save 保存的文件加载, 文件与 disk 不匹配时 valid 为 false.
+        NtfsPathTable(std::string const &file, Ntfs &disk)
+            : NtfsStructureBase(true) {
+            std::ifstream in(file, std::ios::binary);
+            FileHeader header;
+            if (!in.read((char *)&header, sizeof(header)) ||
+                memcmp(header.magic, "ABKPATH", 8) ||
+                header.version != FileVersion ||
+                header.recordsCount != disk.FileRecordsCount ||
+                header.volumeSerial != disk.bootInfo.volumeSerialNumber ||
+                header.names > NoEntry || header.childrenCount > NoEntry) {
+                Reset();
+                return;
+            }
+            uint64_t n = header.recordsCount;
+            volumeSerial = header.volumeSerial;
+            upCase = disk.GetUpCase();
+            buildStats.entries = header.entries;
+            buildStats.names = header.names;
+            if (!ReadArray(in, parents, n) || !ReadArray(in, nameIds, n) ||
+                !ReadArray(in, nameSpaces, n) ||
+                !ReadArray(in, childBeg, n + 1) ||
+                !ReadArray(in, children, header.childrenCount)) {
+                Reset();
+                return;
+            }
+            nameOffs.assign(1, 0);
+            for (uint64_t i = 0; i < header.names; i++) {
+                uint16_t len;
+                if (!in.read((char *)&len, sizeof(len))) break;
+                size_t off = pool.size();
+                pool.resize(off + len);
+                if (len && !in.read((char *)&pool[off], len * 2)) break;
+                nameOffs.push_back((uint32_t)pool.size());
+            }
+            bool ok = nameOffs.size() == header.names + 1 &&
+                      childBeg[n] == header.childrenCount;
+            for (uint64_t i = 0; ok && i < n; i++) {
+                ok = childBeg[i] <= childBeg[i + 1] &&
+                     (!HasEntry(i) || nameIds[i] < header.names);
+            }
+            for (uint64_t i = 0; ok && i < children.size(); i++) {
+                ok = children[i] < n;
+            }
+            if (!ok) {
+                Reset();
+            }
+        }
+
+        // 保存到文件, 之后可用对应的构造函数加载.
+        bool Save(std::string const &file) const {
+            if (!valid) return false;
+            std::ofstream out(file, std::ios::binary | std::ios::trunc);
+            FileHeader header = {"ABKPATH",
+                                 FileVersion,
+                                 (uint32_t)parents.size(),
+                                 volumeSerial,
+                                 buildStats.entries,
+                                 nameOffs.size() - 1,
+                                 children.size()};
+            out.write((char const *)&header, sizeof(header));
+            WriteArray(out, parents);
+            WriteArray(out, nameIds);
+            WriteArray(out, nameSpaces);
+            WriteArray(out, childBeg);
+            WriteArray(out, children);
+            for (uint64_t i = 0; i + 1 < nameOffs.size(); i++) {
+                uint16_t len = (uint16_t)(nameOffs[i + 1] - nameOffs[i]);
+                out.write((char const *)&len, sizeof(len));
+                out.write((char const *)(pool.data() + nameOffs[i]), len * 2);
+            }
+            return (bool)out;
+        }
+
+        BuildStats const &GetBuildStats() const { return buildStats; }
+
+        // 有文件名的文件记录数
+        uint64_t Size() const { return buildStats.entries; }
+
+        // 占用的内存 (单位: 字节)
+        uint64_t GetMemoryUsage() const {
+            return parents.capacity() * sizeof(parents[0]) +
+                   nameIds.capacity() * sizeof(nameIds[0]) +
+                   nameSpaces.capacity() * sizeof(nameSpaces[0]) +
+                   pool.capacity() * sizeof(pool[0]) +
+                   nameOffs.capacity() * sizeof(nameOffs[0]) +
+                   childBeg.capacity() * sizeof(childBeg[0]) +
+                   children.capacity() * sizeof(children[0]);
+        }
+
+        // 没有文件名时返回 false.
+        bool GetEntry(uint64_t FRN, uint64_t &parent, std::wstring &name,
+                      uint8_t &nameSpace) const {
+            if (!HasEntry(FRN)) return false;
+            parent = parents[FRN];
+            name.clear();
+            AppendName(name, FRN);
+            nameSpace = nameSpaces[FRN];
+            return true;
+        }
+
+        std::wstring GetName(uint64_t FRN) const {
+            std::wstring name;
+            if (HasEntry(FRN)) AppendName(name, FRN);
+            return name;
+        }
+
+        uint64_t GetChildrenCount(uint64_t FRN) const {
+            if (FRN + 1 >= childBeg.size()) return 0;
+            return childBeg[FRN + 1] - childBeg[FRN];
+        }
+
+        // 按文件名顺序遍历目录 FRN 的子节点, callback 返回 false 时停止.
+        void ForEachChild(uint64_t FRN,
+                          std::function<bool(uint64_t FRN)> callback) const {
+            if (FRN + 1 >= childBeg.size()) return;
+            for (uint32_t i = childBeg[FRN]; i < childBeg[FRN + 1]; i++) {
+                if (!callback(children[i])) return;
+            }
+        }
+
+        // 在目录 FRN 的子节点中按文件名 (不区分大小写) 二分查找, 找不到返回
+        // NoEntry.
+        uint64_t FindChild(uint64_t FRN, std::wstring const &name) const {
+            if (FRN + 1 >= childBeg.size()) return NoEntry;
+            std::u16string key = WStringToUtf16(name);
+            auto end = children.begin() + childBeg[FRN + 1];
+            auto it = std::lower_bound(
+                children.begin() + childBeg[FRN], end, key,
+                [&](uint32_t child, std::u16string const &n) {
+                    return CompareName(child, n.data(), n.size()) < 0;
+                });
+            if (it == end || CompareName(*it, key.data(), key.size())) {
+                return NoEntry;
+            }
+            return *it;
+        }
+
+        // 深度优先 (先序) 遍历目录 FRN 下的所有子孙, depth 从 1 开始.
+        // callback 返回 false 时停止.
+        void ForEachDescendant(
+            uint64_t FRN,
+            std::function<bool(uint64_t FRN, uint32_t depth)> callback) const {
+            if (FRN + 1 >= childBeg.size()) return;
+            // 损坏的卷中父目录可能成环
+            std::vector<bool> visited(parents.size());
+            visited[FRN] = true;
+            std::vector<std::pair<uint32_t, uint32_t>> stack{
+                {childBeg[FRN], childBeg[FRN + 1]}};
+            while (!stack.empty()) {
+                auto &top = stack.back();
+                if (top.first == top.second) {
+                    stack.pop_back();
+                    continue;
+                }
+                uint32_t child = children[top.first++];
+                if (visited[child]) continue;
+                visited[child] = true;
+                if (!callback(child, (uint32_t)stack.size())) return;
+                if (childBeg[child] != childBeg[child + 1]) {
+                    stack.emplace_back(childBeg[child], childBeg[child + 1]);
+                }
+            }
+        }
+
+        // 文件的完整路径. 无法到达根目录时 (父目录缺失或成环) 只返回能找到
+        // 的部分, 不以 sep 开头. 没有文件名时返回空串.
+        std::wstring GetPath(uint64_t FRN, std::wstring const &sep = L"\\") {
+            if (FRN == RootFRN) return sep;
+            std::vector<uint32_t> chain;
+            while (HasEntry(FRN) && FRN != RootFRN &&
+                   chain.size() < Ntfs::MaxPathDepth) {
+                chain.push_back((uint32_t)FRN);
+                FRN = parents[FRN];
+            }
+            std::wstring path;
+            for (auto it = chain.rbegin(); it != chain.rend(); it++) {
+                if (FRN == RootFRN || it != chain.rbegin()) path += sep;
+                AppendName(path, *it);
+            }
+            return path;
+        }
+
+        // 按目录树深度优先遍历所有文件的路径, 同一目录下的文件共享路径前缀,
+        // 每个路径只在已有前缀后追加一个文件名. 不能从根目录到达的文件最后
+        // 按 GetPath 的方式给出. callback 返回 false 时停止.
+        void ForEachPath(
+            std::function<bool(uint64_t FRN, std::wstring const &path)>
+                callback,
+            std::wstring const &sep = L"\\") {
+            uint64_t n = parents.size();
+            if (n <= RootFRN || childBeg.size() != n + 1 ||
+                !callback(RootFRN, sep)) {
+                return;
+            }
+
+            struct Level {
+                uint32_t FRN;
+                uint32_t next;
+                // 此目录的路径长度
+                size_t len;
+            };
+            std::vector<bool> visited(n);
+            visited[RootFRN] = true;
+            std::vector<Level> stack{Level{RootFRN, childBeg[RootFRN], 0}};
+            std::wstring path;
+            while (!stack.empty()) {
+                Level &top = stack.back();
+                if (top.next == childBeg[top.FRN + 1]) {
+                    stack.pop_back();
+                    continue;
+                }
+                uint32_t child = children[top.next++];
+                if (visited[child]) continue;
+                visited[child] = true;
+                path.resize(top.len);
+                path += sep;
+                AppendName(path, child);
+                if (!callback(child, path)) return;
+                if (childBeg[child] != childBeg[child + 1]) {
+                    stack.push_back(Level{child, childBeg[child], path.size()});
+                }
+            }
+            for (uint64_t i = 0; i < n; i++) {
+                if (!visited[i] && HasEntry(i) &&
+                    !callback(i, GetPath(i, sep))) {
+                    return;
+                }
+            }
+        }
+
+    protected:
+        virtual NtfsPathTable &Copy(NtfsStructureBase const &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T const &rr = (T const &)r;
+            this->parents = rr.parents;
+            this->nameIds = rr.nameIds;
+            this->nameSpaces = rr.nameSpaces;
+            this->pool = rr.pool;
+            this->nameOffs = rr.nameOffs;
+            this->childBeg = rr.childBeg;
+            this->children = rr.children;
+            this->volumeSerial = rr.volumeSerial;
+            this->upCase = rr.upCase;
+            this->buildStats = rr.buildStats;
+            return *this;
+        }
+        virtual NtfsPathTable &Move(NtfsStructureBase &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T &rr = (T &)r;
+            this->parents = std::move(rr.parents);
+            this->nameIds = std::move(rr.nameIds);
+            this->nameSpaces = std::move(rr.nameSpaces);
+            this->pool = std::move(rr.pool);
+            this->nameOffs = std::move(rr.nameOffs);
+            this->childBeg = std::move(rr.childBeg);
+            this->children = std::move(rr.children);
+            this->volumeSerial = rr.volumeSerial;
+            this->upCase = std::move(rr.upCase);
+            this->buildStats = rr.buildStats;
+            return *this;
+        }
+    };
+}
@@ -0,0 +1,354 @@
+#pragma once
+#include "ntfs_access.hpp"
+#include "ntfs_app_FileNameIndex.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace abkntfs {
+    // 从任意目录开始通过 $I30 索引递归遍历其下所有文件. 子目录分发到各工作
+    // 线程的队列中, 线程优先处理自己队列末尾的目录 (深度优先, 局部性好),
+    // 空闲时从其他线程队列的头部窃取. 每个目录的结果作为一批交给调用者
+    // 线程, 已产生未交付的批数有上限, 结果流式交付而不在内存中累积.
+    struct NtfsTreeWalker : NtfsStructureBase {
+        // 已产生未交付的结果批数上限 (每个工作线程)
+        static const uint32_t MaxPendingBatchesPerWorker = 16;
+
+        struct Options {
+            // 工作线程数, 0 表示按 CPU 核数
+            uint32_t workers = 0;
+            // 最大深度, 起始目录的子节点深度为 1, 超过此深度的目录不再展开.
+            uint32_t maxDepth = (uint32_t)-1;
+            // 是否展开带重解析点的目录 (junction, 符号链接等)
+            bool followReparse = false;
+            // 路径分隔符
+            std::wstring sep = L"\\";
+        };
+
+        struct Entry {
+            uint64_t FRN;
+            uint16_t seq;
+            // 所在目录的文件记录号
+            uint64_t parent;
+            uint32_t depth;
+            // $I30 中的文件标志 (AttrData_FILE_NAME::FILE_FLAGS)
+            uint32_t flags;
+            // $I30 中的文件大小, 可能不是最新的
+            uint64_t size;
+            std::wstring name;
+
+            bool IsDirectory() const {
+                return flags & AttrData_FILE_NAME::FILE_FLAG_DIRECTORY;
+            }
+        };
+
+        struct WalkStats {
+            // 展开的目录数
+            uint64_t dirs;
+            // 交付的文件数 (含目录)
+            uint64_t entries;
+            // 未展开的重解析点目录数
+            uint64_t reparse;
+            // 已展开过而跳过的目录数 (硬链接或损坏的卷成环)
+            uint64_t revisits;
+            // 无法读取或不是有效目录的目录数
+            uint64_t errors;
+            // 单位: 秒
+            double seconds;
+        };
+
+    private:
+        Ntfs *pNtfs = nullptr;
+
+        struct DirTask {
+            uint64_t FRN;
+            // 为 0 时不校验序列号
+            uint16_t seq;
+            uint32_t depth;
+            // 以 sep 结尾的目录路径, 同一目录下的文件共享.
+            std::shared_ptr<std::wstring const> path;
+        };
+
+        struct Batch {
+            std::shared_ptr<std::wstring const> path;
+            std::vector<Entry> entries;
+        };
+
+        struct TaskQueue {
+            std::mutex lock;
+            std::deque<DirTask> tasks;
+        };
+
+    public:
+        NtfsTreeWalker() = default;
+        NtfsTreeWalker(NtfsTreeWalker const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsTreeWalker &operator=(NtfsTreeWalker const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
+
+        NtfsTreeWalker(Ntfs &disk) : NtfsStructureBase(true), pNtfs(&disk) {
+            if (!disk.valid || !disk.FileRecordsCount) {
+                Reset();
+            }
+        }
+
+        // 遍历目录 rootFRN 下的所有文件 (不含 rootFRN 本身). callback 总在
+        // 调用者线程中执行, 参数为文件及其所在目录的路径 (以 sep 结尾, 相对
+        // 于 rootFRN); 返回 false 时停止. 同一目录的文件连续交付, 目录之间
+        // 的顺序不确定. 每个目录只展开一次, 8.3 短文件名项不重复交付.
+        WalkStats Walk(uint64_t rootFRN,
+                       std::function<bool(Entry const &entry,
+                                          std::wstring const &dirPath)>
+                           callback,
+                       Options const &options) {
+            WalkStats stats = {};
+            if (!valid || rootFRN >= pNtfs->FileRecordsCount) {
+                return stats;
+            }
+            auto beg = std::chrono::steady_clock::now();
+            uint32_t workers = options.workers;
+            if (workers == 0) {
+                workers = std::max(1u, std::thread::hardware_concurrency());
+            }
+            uint64_t maxBatches =
+                (uint64_t)workers * MaxPendingBatchesPerWorker;
+
+            // 已展开的目录, 每位对应一个文件记录号.
+            std::vector<std::atomic<uint64_t>> visited(
+                (pNtfs->FileRecordsCount + 63) / 64);
+            auto markVisited = [&](uint64_t FRN) {
+                uint64_t bit = 1ull << (FRN % 64);
+                return !(visited[FRN / 64].fetch_or(bit) & bit);
+            };
+
+            std::vector<std::unique_ptr<TaskQueue>> queues;
+            for (uint32_t i = 0; i < workers; i++) {
+                queues.emplace_back(new TaskQueue);
+            }
+            // 已入队或正在处理的目录数, 为 0 时遍历结束.
+            std::atomic<uint64_t> pending{1};
+            std::atomic<bool> stop{false};
+            std::atomic<uint64_t> dirs{0}, reparse{0}, revisits{0}, errors{0};
+            // 空闲的线程等待 idleCv, 直到有目录入队, 遍历结束或停止.
+            std::mutex idleLock;
+            std::condition_variable idleCv;
+            // 各队列中的目录总数, 由 idleLock 保护. 入队后才增加, 出队后才
+            // 减少, 可能暂时多于实际的数量, 但不会使等待的线程错过新目录.
+            uint64_t queued = 1;
+
+            std::mutex resultLock;
+            std::condition_variable resultCv, spaceCv;
+            std::deque<Batch> results;
+            bool finished = false;
+
+            markVisited(rootFRN);
+            queues[0]->tasks.push_back(DirTask{
+                rootFRN, 0, 0, std::make_shared<std::wstring>(options.sep)});
+
+            auto tryPop = [&](uint32_t id, DirTask &task) {
+                {
+                    TaskQueue &own = *queues[id];
+                    std::lock_guard<std::mutex> guard(own.lock);
+                    if (!own.tasks.empty()) {
+                        task = std::move(own.tasks.back());
+                        own.tasks.pop_back();
+                        return true;
+                    }
+                }
+                for (uint32_t k = 1; k < workers; k++) {
+                    TaskQueue &victim = *queues[(id + k) % workers];
+                    std::lock_guard<std::mutex> guard(victim.lock);
+                    if (!victim.tasks.empty()) {
+                        task = std::move(victim.tasks.front());
+                        victim.tasks.pop_front();
+                        return true;
+                    }
+                }
+                return false;
+            };
+            auto popTask = [&](uint32_t id, DirTask &task) {
+                if (!tryPop(id, task)) return false;
+                std::lock_guard<std::mutex> guard(idleLock);
+                queued--;
+                return true;
+            };
+
+            auto expand = [&](uint32_t id, DirTask const &task) {
+                NtfsFileRecord record = pNtfs->GetFileRecordByFRN(task.FRN);
+                if (!record.valid ||
+                    (task.seq && record.fixedFields.seqNumber != task.seq)) {
+                    errors++;
+                    return;
+                }
+                NtfsFileNameIndex index{record};
+                if (!index.valid) {
+                    errors++;
+                    return;
+                }
+                dirs++;
+                Batch batch{task.path, {}};
+                std::vector<DirTask> subdirs;
+                for (auto const &view : index) {
+                    AttrData_FILE_NAME::FileInfo const *info =
+                        view.GetFileInfo();
+                    if (nullptr == info ||
+                        info->nameSpace == AttrData_FILE_NAME::NAME_SPACE_DOS) {
+                        continue;
+                    }
+                    NtfsFileReference ref = view.GetFileRef();
+                    // 根目录中指向自身的 "."
+                    if (ref.fileRecordNum == task.FRN) continue;
+                    Entry entry{ref.fileRecordNum,
+                                (uint16_t)ref.seqNum,
+                                task.FRN,
+                                task.depth + 1,
+                                info->flags,
+                                info->realSizeOfFile,
+                                view.GetFileName()};
+                    if (entry.IsDirectory() && entry.depth < options.maxDepth) {
+                        if ((entry.flags &
+                             AttrData_FILE_NAME::FILE_FLAG_REPARSE_POINT) &&
+                            !options.followReparse) {
+                            reparse++;
+                        }
+                        else if (entry.FRN >= pNtfs->FileRecordsCount ||
+                                 !markVisited(entry.FRN)) {
+                            revisits++;
+                        }
+                        else {
+                            subdirs.push_back(DirTask{
+                                entry.FRN, entry.seq, entry.depth,
+                                std::make_shared<std::wstring>(
+                                    *task.path + entry.name + options.sep)});
+                        }
+                    }
+                    batch.entries.push_back(std::move(entry));
+                }
+                if (!subdirs.empty()) {
+                    pending += subdirs.size();
+                    {
+                        TaskQueue &own = *queues[id];
+                        std::lock_guard<std::mutex> guard(own.lock);
+                        for (auto &i : subdirs) {
+                            own.tasks.push_back(std::move(i));
+                        }
+                    }
+                    {
+                        std::lock_guard<std::mutex> guard(idleLock);
+                        queued += subdirs.size();
+                    }
+                    if (subdirs.size() > 1) {
+                        idleCv.notify_all();
+                    }
+                    else {
+                        idleCv.notify_one();
+                    }
+                }
+                if (batch.entries.empty()) return;
+                std::unique_lock<std::mutex> l(resultLock);
+                spaceCv.wait(l, [&] {
+                    return stop || results.size() < maxBatches;
+                });
+                if (stop) return;
+                results.push_back(std::move(batch));
+                resultCv.notify_one();
+            };
+
+            std::vector<std::thread> threads;
+            for (uint32_t i = 0; i < workers; i++) {
+                threads.emplace_back([&, i] {
+                    while (!stop) {
+                        DirTask task;
+                        if (!popTask(i, task)) {
+                            std::unique_lock<std::mutex> l(idleLock);
+                            idleCv.wait(l, [&] {
+                                return queued || pending == 0 || stop;
+                            });
+                            if (pending == 0) break;
+                            continue;
+                        }
+                        expand(i, task);
+                        if (--pending == 0) {
+                            {
+                                std::lock_guard<std::mutex> guard(idleLock);
+                            }
+                            idleCv.notify_all();
+                            std::lock_guard<std::mutex> guard(resultLock);
+                            finished = true;
+                            resultCv.notify_all();
+                        }
+                    }
+                });
+            }
+
+            while (true) {
+                Batch batch;
+                {
+                    std::unique_lock<std::mutex> l(resultLock);
+                    resultCv.wait(l,
+                                  [&] { return finished || !results.empty(); });
+                    if (results.empty()) break;
+                    batch = std::move(results.front());
+                    results.pop_front();
+                    spaceCv.notify_one();
+                }
+                bool goOn = true;
+                for (auto const &i : batch.entries) {
+                    stats.entries++;
+                    if (!callback(i, *batch.path)) {
+                        goOn = false;
+                        break;
+                    }
+                }
+                if (!goOn) break;
+            }
+            {
+                std::lock_guard<std::mutex> guard(resultLock);
+                stop = true;
+            }
+            {
+                std::lock_guard<std::mutex> guard(idleLock);
+            }
+            spaceCv.notify_all();
+            idleCv.notify_all();
+            for (auto &i : threads) {
+                i.join();
+            }
+
+            stats.dirs = dirs;
+            stats.reparse = reparse;
+            stats.revisits = revisits;
+            stats.errors = errors;
+            stats.seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - beg)
+                                .count();
+            return stats;
+        }
+
+        WalkStats Walk(uint64_t rootFRN,
+                       std::function<bool(Entry const &entry,
+                                          std::wstring const &dirPath)>
+                           callback) {
+            return Walk(rootFRN, callback, Options());
+        }
+
+    protected:
+        virtual NtfsTreeWalker &Copy(NtfsStructureBase const &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T const &rr = (T const &)r;
+            this->pNtfs = rr.pNtfs;
+            return *this;
+        }
+        virtual NtfsTreeWalker &Move(NtfsStructureBase &r) override {
+            return Copy(r);
+        }
+    };
+}
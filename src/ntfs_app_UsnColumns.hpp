@@ -0,0 +1,342 @@
+#pragma once
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "ntfs_access.hpp"
+#include "ntfs_app_UsnJrnl.hpp"
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+namespace abkntfs {
+    // 以列的形式保存的 $UsnJrnl 日志. 文件由定长的头和各列组成, 每列按
+    // 8 字节对齐: USN, 时间, 原因, 文件引用, 父目录引用 (含序列号), 文件名
+    // 编号. 文件名去重后以 UTF-8 首尾相接, 第 i 个文件名为 nameBlob 的
+    // [nameOffs[i], nameOffs[i + 1]). 读取时把整个文件映射到内存, 各列
+    // 直接作为数组使用, 不需要解析.
+    struct NtfsUsnColumns : NtfsStructureBase {
+        // 文件格式版本
+        static const uint32_t FileVersion = 1;
+
+#pragma pack(push, 1)
+        struct FileHeader {
+            // "ABKUSNC"
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t volumeSerial;
+            // 日志条数
+            uint64_t count;
+            // 去重后的文件名数和总字节数
+            uint64_t names;
+            uint64_t nameBytes;
+            // 各列在文件中的偏移
+            uint64_t usnOff;
+            uint64_t timeOff;
+            uint64_t reasonOff;
+            uint64_t fileRefOff;
+            uint64_t parentRefOff;
+            uint64_t nameIdOff;
+            uint64_t nameOffsOff;
+            uint64_t nameBlobOff;
+        };
+#pragma pack(pop)
+
+    private:
+        FileHeader header = {};
+        // 映射的文件, 为空时各列指向下面的数组.
+        std::shared_ptr<char> mapping;
+        uint64_t mappingSize = 0;
+        uint64_t const *usns = nullptr;
+        uint64_t const *times = nullptr;
+        uint32_t const *reasons = nullptr;
+        uint64_t const *fileRefs = nullptr;
+        uint64_t const *parentRefs = nullptr;
+        uint32_t const *nameIds = nullptr;
+        uint32_t const *nameOffs = nullptr;
+        char const *nameBlob = nullptr;
+
+        // 逐条添加时的各列
+        std::vector<uint64_t> usnCol, timeCol, fileRefCol, parentRefCol;
+        std::vector<uint32_t> reasonCol, nameIdCol, nameOffsCol;
+        std::string blob;
+        std::unordered_map<std::string, uint32_t> nameDict;
+
+        static uint64_t Align(uint64_t off) { return (off + 7) & ~7ull; }
+
+        static uint64_t RefToU64(NtfsFileReference const &ref) {
+            uint64_t ret;
+            memcpy(&ret, &ref, sizeof(ret));
+            return ret;
+        }
+
+        // 各列指向逐条添加的数组
+        void BindColumns() {
+            usns = usnCol.data();
+            times = timeCol.data();
+            reasons = reasonCol.data();
+            fileRefs = fileRefCol.data();
+            parentRefs = parentRefCol.data();
+            nameIds = nameIdCol.data();
+            nameOffs = nameOffsCol.data();
+            nameBlob = blob.data();
+        }
+
+        template <typename T>
+        static void WriteColumn(std::ofstream &out, uint64_t &off,
+                                T const *data, uint64_t count) {
+            static const char zeros[8] = {};
+            out.write(zeros, Align(off) - off);
+            off = Align(off);
+            out.write((char const *)data, count * sizeof(T));
+            off += count * sizeof(T);
+        }
+
+        // 映射整个文件, 失败返回 nullptr.
+        static std::shared_ptr<char> MapFile(std::string const &file,
+                                             uint64_t &size) {
+#ifdef _WIN32
+            HANDLE fh = CreateFileA(file.c_str(), GENERIC_READ,
+                                    FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                    FILE_ATTRIBUTE_NORMAL, NULL);
+            if (fh == INVALID_HANDLE_VALUE) {
+                return nullptr;
+            }
+            LARGE_INTEGER li = {};
+            GetFileSizeEx(fh, &li);
+            size = li.QuadPart;
+            HANDLE mh = size ? CreateFileMappingA(fh, NULL, PAGE_READONLY, 0,
+                                                  0, NULL)
+                             : NULL;
+            CloseHandle(fh);
+            if (mh == NULL) {
+                return nullptr;
+            }
+            void *p = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mh);
+            if (p == NULL) {
+                return nullptr;
+            }
+            return std::shared_ptr<char>(
+                (char *)p, [](char *q) { UnmapViewOfFile(q); });
+#else
+            int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return nullptr;
+            }
+            struct stat st = {};
+            fstat(fd, &st);
+            size = st.st_size;
+            void *p = size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0)
+                           : MAP_FAILED;
+            close(fd);
+            if (p == MAP_FAILED) {
+                return nullptr;
+            }
+            uint64_t len = size;
+            return std::shared_ptr<char>(
+                (char *)p, [len](char *q) { munmap(q, len); });
+#endif
+        }
+
+        // 校验第 off 字节开始的 count 个 size 字节的元素在文件内且对齐.
+        bool ColumnInFile(uint64_t off, uint64_t count, uint64_t size) const {
+            return off % 8 == 0 && off <= mappingSize &&
+                   count <= (mappingSize - off) / size;
+        }
+
+    public:
+        NtfsUsnColumns() = default;
+        NtfsUsnColumns(NtfsUsnColumns const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsUsnColumns &operator=(NtfsUsnColumns const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
+
+        // 空的日志集合, 用 Add 添加后 Save.
+        NtfsUsnColumns(Ntfs &disk) : NtfsStructureBase(true) {
+            memcpy(header.magic, "ABKUSNC", 8);
+            header.version = FileVersion;
+            header.volumeSerial = disk.bootInfo.volumeSerialNumber;
+            nameOffsCol.push_back(0);
+            BindColumns();
+        }
+
+        // 映射 Save 保存的文件, 格式不对时 valid 为 false.
+        NtfsUsnColumns(std::string const &file) : NtfsStructureBase(true) {
+            mapping = MapFile(file, mappingSize);
+            if (!mapping || mappingSize < sizeof(header)) {
+                Reset();
+                return;
+            }
+            char const *base = mapping.get();
+            memcpy(&header, base, sizeof(header));
+            uint64_t n = header.count;
+            if (memcmp(header.magic, "ABKUSNC", 8) ||
+                header.version != FileVersion ||
+                header.names >= 0xFFFFFFFF || header.nameBytes >= 0xFFFFFFFF ||
+                !ColumnInFile(header.usnOff, n, 8) ||
+                !ColumnInFile(header.timeOff, n, 8) ||
+                !ColumnInFile(header.reasonOff, n, 4) ||
+                !ColumnInFile(header.fileRefOff, n, 8) ||
+                !ColumnInFile(header.parentRefOff, n, 8) ||
+                !ColumnInFile(header.nameIdOff, n, 4) ||
+                !ColumnInFile(header.nameOffsOff, header.names + 1, 4) ||
+                header.nameBlobOff > mappingSize ||
+                header.nameBytes > mappingSize - header.nameBlobOff) {
+                header = FileHeader{};
+                Reset();
+                return;
+            }
+            usns = (uint64_t const *)(base + header.usnOff);
+            times = (uint64_t const *)(base + header.timeOff);
+            reasons = (uint32_t const *)(base + header.reasonOff);
+            fileRefs = (uint64_t const *)(base + header.fileRefOff);
+            parentRefs = (uint64_t const *)(base + header.parentRefOff);
+            nameIds = (uint32_t const *)(base + header.nameIdOff);
+            nameOffs = (uint32_t const *)(base + header.nameOffsOff);
+            nameBlob = base + header.nameBlobOff;
+            if (nameOffs[header.names] != header.nameBytes) {
+                header = FileHeader{};
+                Reset();
+            }
+        }
+
+        // 添加一条日志. 只能用于新建的集合 (不是映射的文件).
+        void Add(NtfsUsnJrnl::JEntry const &entry) {
+            if (!valid || mapping) return;
+            std::string name = WStringToUtf8(entry.fileName);
+            auto it = nameDict.find(name);
+            if (it == nameDict.end()) {
+                it = nameDict.emplace(name, (uint32_t)nameDict.size()).first;
+                blob += name;
+                nameOffsCol.push_back((uint32_t)blob.size());
+            }
+            usnCol.push_back(entry.fixed.offInJ);
+            timeCol.push_back(entry.fixed.time);
+            reasonCol.push_back(entry.fixed.reason);
+            fileRefCol.push_back(RefToU64(entry.fixed.fileRef));
+            parentRefCol.push_back(RefToU64(entry.fixed.parentFileRef));
+            nameIdCol.push_back(it->second);
+            header.count = usnCol.size();
+            header.names = nameDict.size();
+            header.nameBytes = blob.size();
+            BindColumns();
+        }
+
+        // 保存到文件, 之后可用对应的构造函数映射.
+        bool Save(std::string const &file) {
+            if (!valid) return false;
+            uint64_t n = header.count;
+            FileHeader h = header;
+            h.usnOff = Align(sizeof(h));
+            h.timeOff = Align(h.usnOff + n * 8);
+            h.reasonOff = Align(h.timeOff + n * 8);
+            h.fileRefOff = Align(h.reasonOff + n * 4);
+            h.parentRefOff = Align(h.fileRefOff + n * 8);
+            h.nameIdOff = Align(h.parentRefOff + n * 8);
+            h.nameOffsOff = Align(h.nameIdOff + n * 4);
+            h.nameBlobOff = Align(h.nameOffsOff + (h.names + 1) * 4);
+            std::ofstream out(file, std::ios::binary | std::ios::trunc);
+            out.write((char const *)&h, sizeof(h));
+            uint64_t off = sizeof(h);
+            WriteColumn(out, off, usns, n);
+            WriteColumn(out, off, times, n);
+            WriteColumn(out, off, reasons, n);
+            WriteColumn(out, off, fileRefs, n);
+            WriteColumn(out, off, parentRefs, n);
+            WriteColumn(out, off, nameIds, n);
+            WriteColumn(out, off, nameOffs, h.names + 1);
+            WriteColumn(out, off, nameBlob, h.nameBytes);
+            return (bool)out;
+        }
+
+        // 日志条数
+        uint64_t Size() const { return header.count; }
+
+        // 去重后的文件名数
+        uint64_t GetNamesCount() const { return header.names; }
+
+        uint64_t GetVolumeSerial() const { return header.volumeSerial; }
+
+        // 各列, 长度均为 Size().
+        uint64_t const *USNs() const { return usns; }
+        uint64_t const *Times() const { return times; }
+        uint32_t const *Reasons() const { return reasons; }
+        uint64_t const *FileRefs() const { return fileRefs; }
+        uint64_t const *ParentRefs() const { return parentRefs; }
+        uint32_t const *NameIds() const { return nameIds; }
+
+        NtfsFileReference GetFileRef(uint64_t i) const {
+            NtfsFileReference ret;
+            memcpy(&ret, &fileRefs[i], sizeof(ret));
+            return ret;
+        }
+
+        NtfsFileReference GetParentRef(uint64_t i) const {
+            NtfsFileReference ret;
+            memcpy(&ret, &parentRefs[i], sizeof(ret));
+            return ret;
+        }
+
+        // 第 i 条日志的 UTF-8 文件名, 不以 0 结尾. 文件损坏时为空.
+        char const *GetNameUtf8(uint64_t i, uint32_t &len) const {
+            uint32_t id = nameIds[i];
+            len = 0;
+            if (id >= header.names || nameOffs[id] > nameOffs[id + 1] ||
+                nameOffs[id + 1] > header.nameBytes) {
+                return nameBlob;
+            }
+            len = nameOffs[id + 1] - nameOffs[id];
+            return nameBlob + nameOffs[id];
+        }
+
+        std::wstring GetFileName(uint64_t i) const {
+            uint32_t len;
+            char const *p = GetNameUtf8(i, len);
+            return Utf8ToWString(p, len);
+        }
+
+    protected:
+        virtual NtfsUsnColumns &Copy(NtfsStructureBase const &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T const &rr = (T const &)r;
+            this->header = rr.header;
+            this->mapping = rr.mapping;
+            this->mappingSize = rr.mappingSize;
+            this->usnCol = rr.usnCol;
+            this->timeCol = rr.timeCol;
+            this->reasonCol = rr.reasonCol;
+            this->fileRefCol = rr.fileRefCol;
+            this->parentRefCol = rr.parentRefCol;
+            this->nameIdCol = rr.nameIdCol;
+            this->nameOffsCol = rr.nameOffsCol;
+            this->blob = rr.blob;
+            this->nameDict = rr.nameDict;
+            if (mapping) {
+                this->usns = rr.usns;
+                this->times = rr.times;
+                this->reasons = rr.reasons;
+                this->fileRefs = rr.fileRefs;
+                this->parentRefs = rr.parentRefs;
+                this->nameIds = rr.nameIds;
+                this->nameOffs = rr.nameOffs;
+                this->nameBlob = rr.nameBlob;
+            }
+            else {
+                BindColumns();
+            }
+            return *this;
+        }
+        virtual NtfsUsnColumns &Move(NtfsStructureBase &r) override {
+            return Copy(r);
+        }
+    };
+}
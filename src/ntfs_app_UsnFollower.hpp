@@ -0,0 +1,199 @@
+#pragma once
+#include "ntfs_access.hpp"
+#include "ntfs_app_UsnJrnl.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+namespace abkntfs {
+    // 持续跟踪 $UsnJrnl. 记录下一条要读取的 USN, 每次轮询重新读取 $J 的
+    // 大小和 Data Runs, 只读取新增的日志. $Max 中的 USN ID 改变 (日志被
+    // 删除重建) 时从头读取, 最低有效 USN 超过记录的位置 (旧日志被释放) 时
+    // 跳过丢失的部分. 位置 (检查点) 可保存到状态文件, 重启后从中断处继续.
+    // 检查点在交付之后保存, 中断时最后一批日志可能重复交付, 但不会遗漏.
+    struct NtfsUsnFollower : NtfsStructureBase {
+        // 状态文件格式版本
+        static const uint32_t FileVersion = 1;
+
+        struct Checkpoint {
+            uint64_t volumeSerial;
+            // 检查点所属日志的 USN ID
+            uint64_t usnId;
+            // 下一条要读取的日志的 USN
+            uint64_t nextUSN;
+        };
+
+        struct PollStats {
+            // 日志可读 (Refresh 成功)
+            bool ok;
+            // USN ID 改变或 $J 变小, 从头读取
+            bool reset;
+            // 交付的日志数
+            uint64_t entries;
+            // 已被释放而未能读取的字节数
+            uint64_t lostBytes;
+            // 本次读取的范围 [fromUSN, toUSN)
+            uint64_t fromUSN, toUSN;
+            // callback 返回了 false
+            bool stopped;
+        };
+
+    private:
+#pragma pack(push, 1)
+        struct FileHeader {
+            // "ABKUSN"
+            char magic[8];
+            uint32_t version;
+            uint32_t reserved;
+            uint64_t volumeSerial;
+            uint64_t usnId;
+            uint64_t nextUSN;
+        };
+#pragma pack(pop)
+
+        Ntfs *pNtfs = nullptr;
+        NtfsUsnJrnl usnJrnl;
+        Checkpoint checkpoint = {};
+
+    public:
+        NtfsUsnFollower() = default;
+        NtfsUsnFollower(NtfsUsnFollower const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsUsnFollower &operator=(NtfsUsnFollower const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
+
+        // 从当前的末尾开始跟踪, 只交付之后写入的日志.
+        NtfsUsnFollower(Ntfs &disk)
+            : NtfsStructureBase(true), pNtfs(&disk), usnJrnl(disk) {
+            if (!usnJrnl.valid) {
+                Reset();
+                return;
+            }
+            checkpoint = {disk.bootInfo.volumeSerialNumber,
+                          usnJrnl.GetUsnId(), usnJrnl.GetDataSize()};
+        }
+
+        NtfsUsnJrnl &GetUsnJrnl() { return usnJrnl; }
+
+        Checkpoint const &GetCheckpoint() const { return checkpoint; }
+
+        // 从 usn 开始跟踪, usn 应为日志的开头 (比如 SeekUSN 的结果).
+        void SetPosition(uint64_t usn) {
+            checkpoint.usnId = usnJrnl.GetUsnId();
+            checkpoint.nextUSN = usn;
+        }
+
+        // 从 Save 保存的文件加载检查点, 文件不存在, 格式不对或来自其他卷时
+        // 返回 false 且不改变位置. 检查点的 USN ID 不是当前的时, 下次 Poll
+        // 从头读取.
+        bool Load(std::string const &file) {
+            if (!valid) return false;
+            std::ifstream in(file, std::ios::binary);
+            FileHeader header;
+            if (!in.read((char *)&header, sizeof(header)) ||
+                memcmp(header.magic, "ABKUSN", 7) ||
+                header.version != FileVersion ||
+                header.volumeSerial != checkpoint.volumeSerial) {
+                return false;
+            }
+            checkpoint.usnId = header.usnId;
+            checkpoint.nextUSN = header.nextUSN;
+            return true;
+        }
+
+        // 保存检查点. 先写入临时文件再改名, 中断时不会留下不完整的文件.
+        bool Save(std::string const &file) const {
+            if (!valid) return false;
+            std::string tmp = file + ".tmp";
+            {
+                std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+                FileHeader header = {"ABKUSN",
+                                     FileVersion,
+                                     0,
+                                     checkpoint.volumeSerial,
+                                     checkpoint.usnId,
+                                     checkpoint.nextUSN};
+                if (!out.write((char const *)&header, sizeof(header))) {
+                    return false;
+                }
+            }
+#ifdef _WIN32
+            std::remove(file.c_str());
+#endif
+            return 0 == std::rename(tmp.c_str(), file.c_str());
+        }
+
+        // 读取检查点之后新增的, 匹配 filter 的日志交给 callback, 返回 false
+        // 时停止 (该条视为已读取). 之后检查点移到下一条未读取的日志.
+        PollStats Poll(NtfsUsnJrnl::Filter const &filter,
+                       std::function<bool(NtfsUsnJrnl::JEntry const &entry)>
+                           callback) {
+            PollStats stats = {};
+            if (!valid || !usnJrnl.Refresh()) {
+                return stats;
+            }
+            stats.ok = true;
+            uint64_t size = usnJrnl.GetDataSize();
+            if (usnJrnl.GetUsnId() != checkpoint.usnId ||
+                checkpoint.nextUSN > size) {
+                stats.reset = true;
+                checkpoint.usnId = usnJrnl.GetUsnId();
+                checkpoint.nextUSN = usnJrnl.GetFirstUSN();
+            }
+            uint64_t first = usnJrnl.GetFirstUSN();
+            if (checkpoint.nextUSN < first) {
+                stats.lostBytes = first - checkpoint.nextUSN;
+                checkpoint.nextUSN = first;
+            }
+            stats.fromUSN = checkpoint.nextUSN;
+            checkpoint.nextUSN = usnJrnl.ForEach(
+                checkpoint.nextUSN, size, filter,
+                [&](NtfsUsnJrnl::JEntry const &entry) {
+                    stats.entries++;
+                    if (!callback(entry)) {
+                        stats.stopped = true;
+                        return false;
+                    }
+                    return true;
+                });
+            stats.toUSN = checkpoint.nextUSN;
+            return stats;
+        }
+
+        // 每隔 interval 调用一次 Poll, 每次之后调用 onPoll (可在其中保存
+        // 检查点). callback 或 onPoll 返回 false 时停止. 新日志最迟在写入
+        // 后一个 interval 加一次读取的时间内交付.
+        void Follow(std::chrono::milliseconds interval,
+                    NtfsUsnJrnl::Filter const &filter,
+                    std::function<bool(NtfsUsnJrnl::JEntry const &entry)>
+                        callback,
+                    std::function<bool(PollStats const &stats)> onPoll) {
+            while (valid) {
+                auto beg = std::chrono::steady_clock::now();
+                PollStats stats = Poll(filter, callback);
+                if (!onPoll(stats) || stats.stopped) {
+                    return;
+                }
+                std::this_thread::sleep_until(beg + interval);
+            }
+        }
+
+    protected:
+        virtual NtfsUsnFollower &Copy(NtfsStructureBase const &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T const &rr = (T const &)r;
+            this->pNtfs = rr.pNtfs;
+            this->usnJrnl = rr.usnJrnl;
+            this->checkpoint = rr.checkpoint;
+            return *this;
+        }
+        virtual NtfsUsnFollower &Move(NtfsStructureBase &r) override {
+            return Copy(r);
+        }
+    };
+}
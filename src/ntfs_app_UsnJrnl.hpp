@@ -1,6 +1,11 @@
 #pragma once
 #include "ntfs_access.hpp"
 #include "ntfs_app_FileNameIndex.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <unordered_set>
+#include <utility>
 
 namespace abkntfs {
 
@@ -105,6 +110,32 @@ namespace abkntfs {
         };
 #pragma pack(pop)
 
+        // 条目不会跨越 USN 页, 页末尾不足一个条目的空间以 0 填充.
+        static const uint64_t JPageSize = 0x1000;
+        // 流式读取时每次读取 $J 的字节数
+        static const uint64_t JWindowSize = 0x100000;
+
+        // 校验 p 处 USN 为 usn 的条目头, avail 为可读取的字节数. 有效时
+        // 返回条目大小 (可能大于 avail), 无效返回 0.
+        static uint32_t EntrySize(char const *p, uint64_t avail, uint64_t usn) {
+            if (avail < sizeof(JEntryFixed)) {
+                return 0;
+            }
+            JEntryFixed fixed;
+            memcpy(&fixed, p, sizeof(fixed));
+            if (fixed.offInJ != usn || fixed.offToFileName < sizeof(fixed)) {
+                return 0;
+            }
+            // 总大小 8 字节对齐
+            uint64_t expectedSize =
+                ((fixed.offToFileName + fixed.sizeOfFileName + 0x07) / 0x08) *
+                0x08;
+            if (fixed.sizeOfEntry != expectedSize) {
+                return 0;
+            }
+            return fixed.sizeOfEntry;
+        }
+
         // $UsnJrnl:$J 条目
         struct JEntry : NtfsStructureBase {
             JEntryFixed fixed;
@@ -119,27 +150,19 @@ namespace abkntfs {
             }
 
             JEntry(NtfsDataBlock &data, uint64_t off)
+                : JEntry((char const *)data, data.len(), off) {}
+
+            // data 指向 USN 为 off 的条目, len 为可读取的字节数.
+            JEntry(char const *data, uint64_t len, uint64_t off)
                 : NtfsStructureBase(true) {
-                if (data.len() < sizeof(fixed)) {
+                uint32_t size = EntrySize(data, len, off);
+                if (!size || size > len) {
                     Reset();
                     return;
                 }
                 memcpy(&fixed, data, sizeof(fixed));
-                if (fixed.offInJ != off) {
-                    Reset();
-                    return;
-                }
-                // 总大小 8 字节对齐
-                uint64_t expectedSize =
-                    ((fixed.offToFileName + fixed.sizeOfFileName + 0x07) /
-                     0x08) *
-                    0x08;
-                if (fixed.sizeOfEntry != expectedSize) {
-                    Reset();
-                    return;
-                }
-                fileName.assign((wchar_t *)(data + fixed.offToFileName),
-                                fixed.sizeOfFileName >> 1);
+                fileName = Utf16ToWString(data + fixed.offToFileName,
+                                          fixed.sizeOfFileName >> 1);
             }
 
         protected:
@@ -155,10 +178,39 @@ namespace abkntfs {
             }
         };
 
-        Ntfs *pNtfs;
+        // 日志过滤条件. 在条目头和原始的 UTF-16 文件名上求值, 只有匹配的
+        // 条目才解码为 JEntry. 各项条件同时满足才匹配.
+        struct Filter {
+            // 原因 (REASON_FLAGS) 至少包含其中一位, 0 表示不限.
+            uint32_t reasonMask = 0;
+            // (sourceInfo & sourceInfoMask) == sourceInfoValue
+            uint32_t sourceInfoMask = 0;
+            uint32_t sourceInfoValue = 0;
+            // 文件记录号, 父目录的文件记录号, 空表示不限.
+            std::unordered_set<uint64_t> FRNs;
+            std::unordered_set<uint64_t> parentFRNs;
+            // 时间范围 [timeBeg, timeEnd)
+            uint64_t timeBeg = 0;
+            uint64_t timeEnd = (uint64_t)-1;
+            // 文件名通配符 (* 匹配任意个字符, ? 匹配一个), 按卷的 $UpCase
+            // 不区分大小写; 空表示不限.
+            std::wstring nameGlob;
+        };
+
+        Ntfs *pNtfs = nullptr;
         NtfsFileReference usnJrnlFRN;
 
     private:
+        // $UsnJrnl:$J, 构造时解析一次, 之后读取日志不再访问文件记录.
+        AttrData_DATA dataJ;
+        // $J 中已分配 (非稀疏) 的字节范围 [first, second), 按位置排序.
+        // 日志只保留最近的一段, 之前的部分被释放为稀疏.
+        std::vector<std::pair<uint64_t, uint64_t>> allocJ;
+        // 构造时 $Max 中的最低有效 USN, 之前的数据不再解析.
+        uint64_t lowestValidUSN = 0;
+        // 构造时 $Max 中的 USN ID, 日志被删除重建后改变.
+        uint64_t usnId = 0;
+
         Max GetMax(NtfsFileRecord &usnJrnl) {
             Max ret = Max{};
             if (!valid) {
@@ -170,12 +222,326 @@ namespace abkntfs {
                 return ret;
             }
             memcpy(&ret, (NtfsDataBlock)pDataMax->attrData,
-                   pDataMax->attrData.len());
+                   std::min<uint64_t>(sizeof(ret), pDataMax->attrData.len()));
             return ret;
         }
 
+        // usn 处的数据不是有效条目 (页末尾的填充, 或从条目中间开始) 时下一
+        // 个要尝试的位置. 有效条目头中的 USN 必须等于其位置, 按 8 字节对齐
+        // 逐个位置尝试即可重新同步; 连续的 0 (填充) 一次跳过.
+        static uint64_t Resync(char const *p, uint64_t avail, uint64_t usn) {
+            uint64_t k = ((usn + 8) & ~(uint64_t)7) - usn;
+            uint64_t word;
+            while (k + sizeof(word) <= avail) {
+                memcpy(&word, p + k, sizeof(word));
+                if (word) break;
+                k += sizeof(word);
+            }
+            return usn + k;
+        }
+
+        // 解析窗口 [wBeg, wEnd) 中从 usn 开始, 起始位置小于 end 的条目, 依次
+        // 调用 f(usn, 条目数据, 条目大小), 遇到无效的数据时重新同步. 条目
+        // 跨越窗口末尾且 more 为 true 时停在该条目处, 由调用者从这里读取下
+        // 一个窗口. f 返回 false 时置位 stop. 返回下一个要解析的位置.
+        template <typename F>
+        static uint64_t ParseWindow(char const *base, uint64_t wBeg,
+                                    uint64_t wEnd, bool more, uint64_t usn,
+                                    uint64_t end, F &&f, bool &stop) {
+            while (usn < end && usn < wEnd) {
+                uint64_t avail = wEnd - usn;
+                if (avail < sizeof(JEntryFixed) && more) {
+                    return usn;
+                }
+                uint32_t size = EntrySize(base + (usn - wBeg), avail, usn);
+                if (size > avail) {
+                    if (more) {
+                        return usn;
+                    }
+                    size = 0;
+                }
+                if (!size) {
+                    usn = Resync(base + (usn - wBeg), avail, usn);
+                    continue;
+                }
+                if (!f(usn, base + (usn - wBeg), size)) {
+                    stop = true;
+                    return usn + size;
+                }
+                usn += size;
+            }
+            return usn;
+        }
+
+        // 把 $J 的 data runs 转为已分配 (非稀疏) 的字节范围.
+        void LoadAllocRanges() {
+            allocJ.clear();
+            uint64_t size = dataJ.GetDataSize();
+            if (dataJ.dataRunsMap.empty()) {
+                // 驻留属性
+                if (size) allocJ.emplace_back(0, size);
+                return;
+            }
+            uint64_t sectorSize = pNtfs->GetSectorSize();
+            uint64_t pos =
+                dataJ.VCN_beg * pNtfs->bootInfo.sectorsPerCluster * sectorSize;
+            for (auto const &i : dataJ.dataRunsMap) {
+                uint64_t beg = pos;
+                pos += i.secNum * sectorSize;
+                uint64_t end = std::min(pos, size);
+                if (i.sparse || beg >= end) {
+                    continue;
+                }
+                if (!allocJ.empty() && allocJ.back().second == beg) {
+                    allocJ.back().second = end;
+                }
+                else {
+                    allocJ.emplace_back(beg, end);
+                }
+            }
+        }
+
+        // usn 所在或之后的第一个已分配范围, 没有则返回 allocJ.end().
+        std::vector<std::pair<uint64_t, uint64_t>>::const_iterator
+        AllocRangeFrom(uint64_t usn) const {
+            auto i = std::upper_bound(
+                allocJ.begin(), allocJ.end(), usn,
+                [](uint64_t v, std::pair<uint64_t, uint64_t> const &r) {
+                    return v < r.second;
+                });
+            return i;
+        }
+
+        // 按 USN 递增顺序解析 [usn, end) 内开始的条目, 返回下一个未解析的
+        // USN. 只读取已分配的范围, 稀疏的部分 (全为 0) 直接跳过.
+        template <typename F>
+        uint64_t ScanForward(uint64_t usn, uint64_t end, F &&f) {
+            uint64_t size = GetDataSize();
+            if (end > size) {
+                end = size;
+            }
+            usn = std::max(usn, lowestValidUSN);
+            // 上一个窗口中没有解析出任何条目 (条目跨越窗口末尾)
+            bool retry = false;
+            uint64_t windowSize = JWindowSize;
+            while (usn < end) {
+                auto range = AllocRangeFrom(usn);
+                if (range == allocJ.end()) {
+                    return std::max(usn, end);
+                }
+                if (usn < range->first) {
+                    usn = range->first;
+                    retry = false;
+                    continue;
+                }
+                uint64_t len = std::min(windowSize, range->second - usn);
+                // 范围较小时只读到 end 所在页的末尾.
+                uint64_t need = (end + JPageSize - 1) / JPageSize * JPageSize;
+                if (!retry && need - usn < len) {
+                    len = need - usn;
+                }
+                NtfsDataBlock win = dataJ.ReadData(usn, len);
+                if (!win.len()) {
+                    break;
+                }
+                uint64_t wEnd = usn + win.len();
+                bool stop = false;
+                uint64_t next =
+                    ParseWindow((char const *)win, usn, wEnd,
+                                wEnd < range->second, usn, end, f, stop);
+                if (stop) {
+                    return next;
+                }
+                if (next == usn) {
+                    if (retry) {
+                        next = Resync((char const *)win, win.len(), usn);
+                    }
+                    retry = !retry;
+                }
+                else {
+                    retry = false;
+                }
+                // 条目不会延伸到稀疏的部分
+                usn = std::min(next, range->second);
+            }
+            return usn;
+        }
+
+        // 按 USN 递减顺序解析 end 之前开始的条目. 窗口从 USN 页边界 (或
+        // 已分配范围的起点) 开始, 窗口内先正向解析再倒序交付. 窗口从较小的
+        // 大小开始逐次翻倍, 只取最新几条时不必读取整个窗口.
+        template <typename F> void ScanReverse(uint64_t end, F &&f) {
+            uint64_t size = GetDataSize();
+            uint64_t top = std::min(end, size);
+            uint64_t span = JPageSize * 16;
+            // 窗口内条目的 (偏移, 大小)
+            std::vector<std::pair<uint64_t, uint32_t>> entries;
+            while (top > lowestValidUSN) {
+                // top 之前最后一个已分配范围
+                auto range = AllocRangeFrom(top);
+                if (range != allocJ.end() && range->first < top) {
+                    top = std::min(top, range->second);
+                }
+                else if (range == allocJ.begin()) {
+                    return;
+                }
+                else {
+                    --range;
+                    top = range->second;
+                }
+                uint64_t wBeg = 0;
+                if (top > span) {
+                    wBeg = (top - span) / JPageSize * JPageSize;
+                }
+                wBeg = std::max(wBeg, std::max(range->first, lowestValidUSN));
+                if (wBeg >= top) {
+                    return;
+                }
+                if (span < JWindowSize) {
+                    span *= 2;
+                }
+                uint64_t wEnd = std::min(
+                    range->second,
+                    (top + JPageSize - 1) / JPageSize * JPageSize);
+                NtfsDataBlock win = dataJ.ReadData(wBeg, wEnd - wBeg);
+                if (!win.len()) {
+                    return;
+                }
+                char const *base = win;
+                entries.clear();
+                bool stop = false;
+                ParseWindow(
+                    base, wBeg, wBeg + win.len(), false, wBeg, top,
+                    [&](uint64_t usn, char const *, uint32_t len) {
+                        entries.emplace_back(usn - wBeg, len);
+                        return true;
+                    },
+                    stop);
+                for (auto i = entries.rbegin(); i != entries.rend(); ++i) {
+                    if (!f(wBeg + i->first, base + i->first, i->second)) {
+                        return;
+                    }
+                }
+                top = wBeg;
+            }
+        }
+
+        // usn 处或之后的第一个条目, 没有返回 false. 每次只读取一个簇.
+        bool FirstEntryFrom(uint64_t usn, uint64_t &entryUSN,
+                            JEntryFixed &fixed) {
+            uint64_t size = GetDataSize();
+            uint64_t clusterSize =
+                pNtfs->bootInfo.sectorsPerCluster * pNtfs->GetSectorSize();
+            bool found = false;
+            while (!found && usn < size) {
+                uint64_t next =
+                    ScanForward(usn, usn + clusterSize,
+                                [&](uint64_t u, char const *p, uint32_t) {
+                                    memcpy(&fixed, p, sizeof(fixed));
+                                    entryUSN = u;
+                                    found = true;
+                                    return false;
+                                });
+                // 读取失败
+                if (next <= usn) {
+                    break;
+                }
+                usn = next;
+            }
+            return found;
+        }
+
+        // 对原始条目求值的 Filter. 通配符预先转为大写的 UTF-16 码元, 文件名
+        // 转换使用复用的缓冲区, 求值时不分配内存.
+        class FilterMatcher {
+            Filter const &filter;
+            NtfsUpCase const &upCase;
+            std::vector<uint16_t> glob;
+            std::vector<uint16_t> name;
+
+            bool MatchName(char const *p, uint64_t len) {
+                name.resize(len);
+                for (uint64_t i = 0; i < len; i++) {
+                    uint16_t c;
+                    memcpy(&c, p + (i << 1), sizeof(c));
+                    name[i] = upCase.ToUpper(c);
+                }
+                // 回溯到最近的 * 的通配符匹配
+                size_t g = 0, n = 0, star = (size_t)-1, mark = 0;
+                while (n < len) {
+                    if (g < glob.size() &&
+                        (glob[g] == u'?' || glob[g] == name[n])) {
+                        g++;
+                        n++;
+                    }
+                    else if (g < glob.size() && glob[g] == u'*') {
+                        star = g++;
+                        mark = n;
+                    }
+                    else if (star != (size_t)-1) {
+                        g = star + 1;
+                        n = ++mark;
+                    }
+                    else {
+                        return false;
+                    }
+                }
+                while (g < glob.size() && glob[g] == u'*') {
+                    g++;
+                }
+                return g == glob.size();
+            }
+
+        public:
+            FilterMatcher(Filter const &filter, NtfsUpCase const &upCase)
+                : filter(filter), upCase(upCase) {
+                for (char16_t c : WStringToUtf16(filter.nameGlob)) {
+                    glob.push_back(upCase.ToUpper(c));
+                }
+            }
+
+            // p 指向已校验的条目.
+            bool Match(char const *p) {
+                JEntryFixed fixed;
+                memcpy(&fixed, p, sizeof(fixed));
+                if (filter.reasonMask && !(fixed.reason & filter.reasonMask)) {
+                    return false;
+                }
+                if ((fixed.sourceInfo & filter.sourceInfoMask) !=
+                    filter.sourceInfoValue) {
+                    return false;
+                }
+                if (fixed.time < filter.timeBeg ||
+                    fixed.time >= filter.timeEnd) {
+                    return false;
+                }
+                if (!filter.FRNs.empty() &&
+                    !filter.FRNs.count(fixed.fileRef.fileRecordNum)) {
+                    return false;
+                }
+                if (!filter.parentFRNs.empty() &&
+                    !filter.parentFRNs.count(
+                        fixed.parentFileRef.fileRecordNum)) {
+                    return false;
+                }
+                if (!glob.empty() &&
+                    !MatchName(p + fixed.offToFileName,
+                               fixed.sizeOfFileName >> 1)) {
+                    return false;
+                }
+                return true;
+            }
+        };
+
     public:
         NtfsUsnJrnl() = default;
+        NtfsUsnJrnl(NtfsUsnJrnl const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsUsnJrnl &operator=(NtfsUsnJrnl const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
         NtfsUsnJrnl(Ntfs &disk) : NtfsStructureBase(true) {
             if (!disk.valid) {
                 Reset();
@@ -196,6 +562,17 @@ namespace abkntfs {
                 return;
             }
             usnJrnlFRN = usnJrnlInfo.fileRef;
+            // $UsnJrnl:J
+            NtfsFileRecord usnJrnl =
+                disk.GetFileRecordByFRN(usnJrnlFRN.fileRecordNum);
+            AttrData_DATA *pDataJ = usnJrnl.FindSpecAttrData(NTFS_DATA, L"$J");
+            if (nullptr != pDataJ) {
+                dataJ = *pDataJ;
+                LoadAllocRanges();
+            }
+            Max max = GetMax(usnJrnl);
+            lowestValidUSN = max.lowestValidUSN;
+            usnId = max.USN_ID;
         }
 
         Max GetMax() {
@@ -209,73 +586,233 @@ namespace abkntfs {
             return GetMax(usnJrnl);
         }
 
-        std::vector<JEntry> GetLogs(uint64_t vcn) {
-            std::vector<JEntry> ret;
+        // 重新读取 $UsnJrnl 的文件记录, 更新 $J 的大小, 已分配的范围和
+        // $Max, 用于跟踪正在写入的日志. 文件记录和 $J 原末尾所在的簇 (可能
+        // 写入了新的日志) 先从缓存中丢弃. 日志被删除 (可能已重建) 时重新查找
+        // $UsnJrnl. 失败返回 false.
+        bool Refresh() {
             if (!valid) {
-                return ret;
+                return false;
             }
-            // $UsnJrnl 文件记录
+            uint64_t oldSize = GetDataSize();
+            if (oldSize && !dataJ.dataRunsMap.empty()) {
+                uint64_t spc = pNtfs->bootInfo.sectorsPerCluster;
+                uint64_t secSize = pNtfs->GetSectorSize();
+                uint64_t vsn = (oldSize - 1) / secSize / spc * spc;
+                uint64_t count = dataJ.extents.GetSectorsCount();
+                if (spc && vsn < count) {
+                    pNtfs->InvalidateSectors(dataJ.extents.Translate(
+                        vsn, std::min(spc, count - vsn)));
+                }
+            }
+            pNtfs->InvalidateSectors(
+                pNtfs->GetFileRecordAreaByFRN(usnJrnlFRN.fileRecordNum));
             NtfsFileRecord usnJrnl =
                 pNtfs->GetFileRecordByFRN(usnJrnlFRN.fileRecordNum);
-            // $UsnJrnl:J
-            AttrData_DATA *pDataJ = usnJrnl.FindSpecAttrData(NTFS_DATA, L"$J");
+            AttrData_DATA *pDataJ = nullptr;
+            if (usnJrnl.valid &&
+                usnJrnl.fixedFields.seqNumber == usnJrnlFRN.seqNum) {
+                pDataJ = usnJrnl.FindSpecAttrData(NTFS_DATA, L"$J");
+            }
             if (nullptr == pDataJ) {
-                return ret;
+                // $Extend 的索引也可能已改变
+                pNtfs->ClearCaches();
+                NtfsUsnJrnl fresh{*pNtfs};
+                if (!fresh.valid) {
+                    return false;
+                }
+                *this = fresh;
+                return GetDataSize() != 0;
             }
-            if (vcn > pDataJ->VCN_end || vcn < pDataJ->VCN_beg) {
-                return ret;
+            dataJ = *pDataJ;
+            LoadAllocRanges();
+            Max max = GetMax(usnJrnl);
+            lowestValidUSN = max.lowestValidUSN;
+            usnId = max.USN_ID;
+            return true;
+        }
+
+        // 构造或 Refresh 时 $Max 中的 USN ID
+        uint64_t GetUsnId() const { return usnId; }
+
+        // $J 的大小, 即下一条日志的 USN.
+        uint64_t GetDataSize() const {
+            if (!valid || !dataJ.valid) {
+                return 0;
+            }
+            return dataJ.GetDataSize();
+        }
+
+        // 第一个可能存在日志的 USN: 跳过最低有效 USN 之前和稀疏的部分.
+        uint64_t GetFirstUSN() const {
+            auto range = AllocRangeFrom(lowestValidUSN);
+            if (range == allocJ.end()) {
+                return GetDataSize();
+            }
+            return std::max(range->first, lowestValidUSN);
+        }
+
+        // usn 处或之后的第一个条目的 USN (usn 不在条目边界时重新同步), 没有
+        // 则返回 $J 的大小.
+        uint64_t SeekUSN(uint64_t usn) {
+            JEntryFixed fixed;
+            if (!FirstEntryFrom(usn, usn, fixed)) {
+                return GetDataSize();
+            }
+            return usn;
+        }
+
+        // 第一个时间不早于 time 的条目的 USN, 没有则返回 $J 的大小. 日志的
+        // 时间在有效范围内单调递增, 按簇二分查找: 每次探测只解析簇内 (或之
+        // 后) 的第一个有效条目, 最后从前一个簇的第一个条目开始正向查找.
+        uint64_t SeekTime(uint64_t time) {
+            uint64_t size = GetDataSize();
+            if (!size) {
+                return size;
             }
-            // 读取大小
             uint64_t clusterSize =
                 pNtfs->bootInfo.sectorsPerCluster * pNtfs->GetSectorSize();
-            uint64_t off = vcn * clusterSize;
-            NtfsDataBlock entriesData = pDataJ->ReadData(off, clusterSize);
-            while (entriesData.len()) {
-                JEntry t = JEntry{entriesData, off};
-                if (!t.valid) {
-                    break;
+            uint64_t from = GetFirstUSN();
+            uint64_t lo = from / clusterSize;
+            uint64_t hi = (size + clusterSize - 1) / clusterSize;
+            while (lo < hi) {
+                uint64_t mid = lo + (hi - lo) / 2;
+                uint64_t usn;
+                JEntryFixed fixed;
+                if (!FirstEntryFrom(mid * clusterSize, usn, fixed) ||
+                    fixed.time >= time) {
+                    hi = mid;
+                }
+                else {
+                    lo = mid + 1;
+                    from = usn;
                 }
-                entriesData = NtfsDataBlock{entriesData, t.fixed.sizeOfEntry};
-                off += t.fixed.sizeOfEntry;
-                ret.push_back(t);
             }
+            uint64_t ret = size;
+            ScanForward(from, size, [&](uint64_t usn, char const *p, uint32_t) {
+                JEntryFixed fixed;
+                memcpy(&fixed, p, sizeof(fixed));
+                if (fixed.time >= time) {
+                    ret = usn;
+                    return false;
+                }
+                return true;
+            });
             return ret;
         }
 
-        std::vector<JEntry> GetLastN(uint64_t n) {
+        // 按 USN 递增顺序交付 [beg, end) 内开始的条目, callback 返回 false
+        // 时停止. 返回下一个未读取的 USN, 可作为下次调用的 beg.
+        uint64_t ForEach(uint64_t beg, uint64_t end,
+                         std::function<bool(JEntry const &entry)> callback) {
+            if (!GetDataSize()) {
+                return beg;
+            }
+            return ScanForward(
+                beg, end, [&](uint64_t usn, char const *p, uint32_t size) {
+                    return callback(JEntry{p, size, usn});
+                });
+        }
+
+        // 只交付匹配 filter 的条目, 其余同上. 起点早于 filter.timeBeg 时先
+        // 按时间定位.
+        uint64_t ForEach(uint64_t beg, uint64_t end, Filter const &filter,
+                         std::function<bool(JEntry const &entry)> callback) {
+            if (!GetDataSize()) {
+                return beg;
+            }
+            if (filter.timeBeg) {
+                beg = std::max(beg, SeekTime(filter.timeBeg));
+            }
+            FilterMatcher matcher{filter, pNtfs->GetUpCase()};
+            return ScanForward(
+                beg, end, [&](uint64_t usn, char const *p, uint32_t size) {
+                    if (!matcher.Match(p)) {
+                        return true;
+                    }
+                    return callback(JEntry{p, size, usn});
+                });
+        }
+
+        // 按 USN 递减顺序交付 end 之前开始的条目, callback 返回 false 时
+        // 停止.
+        void ForEachReverse(uint64_t end,
+                            std::function<bool(JEntry const &entry)> callback) {
+            if (!GetDataSize()) {
+                return;
+            }
+            ScanReverse(end, [&](uint64_t usn, char const *p, uint32_t size) {
+                return callback(JEntry{p, size, usn});
+            });
+        }
+
+        // 只交付匹配 filter 的条目, 其余同上. 指定了时间范围时先按
+        // filter.timeEnd 定位, 遇到早于 filter.timeBeg 的条目即停止.
+        void ForEachReverse(uint64_t end, Filter const &filter,
+                            std::function<bool(JEntry const &entry)> callback) {
+            if (!GetDataSize()) {
+                return;
+            }
+            if (filter.timeEnd != (uint64_t)-1) {
+                end = std::min(end, SeekTime(filter.timeEnd));
+            }
+            FilterMatcher matcher{filter, pNtfs->GetUpCase()};
+            ScanReverse(end, [&](uint64_t usn, char const *p, uint32_t size) {
+                uint64_t time;
+                memcpy(&time, p + offsetof(JEntryFixed, time), sizeof(time));
+                if (time < filter.timeBeg) {
+                    return false;
+                }
+                if (!matcher.Match(p)) {
+                    return true;
+                }
+                return callback(JEntry{p, size, usn});
+            });
+        }
+
+        // 第 vcn 簇内开始的条目
+        std::vector<JEntry> GetLogs(uint64_t vcn) {
             std::vector<JEntry> ret;
-            if (!valid) {
+            if (!GetDataSize()) {
                 return ret;
             }
-            // $UsnJrnl 文件记录
-            NtfsFileRecord usnJrnl =
-                pNtfs->GetFileRecordByFRN(usnJrnlFRN.fileRecordNum);
-            // $UsnJrnl:J
-            NtfsAttr *pDataJ = usnJrnl.FindSpecAttr(NTFS_DATA, L"$J");
-            if (nullptr == pDataJ) {
+            if (vcn > dataJ.VCN_end || vcn < dataJ.VCN_beg) {
                 return ret;
             }
-            uint64_t clusterSize = pNtfs->bootInfo.sectorsPerCluster *
-                                   pNtfs->bootInfo.bytesPerSector;
-            uint64_t clusters =
-                (pDataJ->GetDataSize() + (clusterSize - 1)) / clusterSize;
-            if (clusters == 0) {
+            uint64_t clusterSize =
+                pNtfs->bootInfo.sectorsPerCluster * pNtfs->GetSectorSize();
+            ForEach(vcn * clusterSize, (vcn + 1) * clusterSize,
+                    [&](JEntry const &entry) {
+                        ret.push_back(entry);
+                        return true;
+                    });
+            return ret;
+        }
+
+        std::vector<JEntry> GetLastN(uint64_t n) {
+            std::vector<JEntry> ret;
+            if (!n) {
                 return ret;
             }
-            uint64_t num = 1;
-            while (ret.size() < n) {
-                auto logs = GetLogs(clusters - num);
-                num++;
-                if (n - ret.size() < logs.size()) {
-                    ret.insert(
-                        ret.begin(),
-                        std::next(logs.begin(), logs.size() - (n - ret.size())),
-                        logs.end());
-                }
-                else {
-                    ret.insert(ret.begin(), logs.begin(), logs.end());
-                }
+            ForEachReverse(GetDataSize(), [&](JEntry const &entry) {
+                ret.push_back(entry);
+                return ret.size() < n;
+            });
+            std::reverse(ret.begin(), ret.end());
+            return ret;
+        }
+
+        // 最新的 n 条匹配 filter 的条目
+        std::vector<JEntry> GetLastN(uint64_t n, Filter const &filter) {
+            std::vector<JEntry> ret;
+            if (!n) {
+                return ret;
             }
+            ForEachReverse(GetDataSize(), filter, [&](JEntry const &entry) {
+                ret.push_back(entry);
+                return ret.size() < n;
+            });
+            std::reverse(ret.begin(), ret.end());
             return ret;
         }
 
@@ -283,7 +820,12 @@ namespace abkntfs {
         virtual NtfsUsnJrnl &Copy(NtfsStructureBase const &r) override {
             using T = std::remove_reference<decltype(*this)>::type;
             T const &rr = (T const &)r;
-
+            this->pNtfs = rr.pNtfs;
+            this->usnJrnlFRN = rr.usnJrnlFRN;
+            this->dataJ = rr.dataJ;
+            this->allocJ = rr.allocJ;
+            this->lowestValidUSN = rr.lowestValidUSN;
+            this->usnId = rr.usnId;
             return *this;
         }
         virtual NtfsUsnJrnl &Move(NtfsStructureBase &r) override {
@@ -0,0 +1,212 @@
+#pragma once
+#include "ntfs_access.hpp"
+#include "ntfs_app_UsnJrnl.hpp"
+#include <unordered_map>
+
+namespace abkntfs {
+    // 求 $UsnJrnl 日志发生时文件所在目录的路径. 目录的 (父目录, 文件名)
+    // 缓存在内存中, 按 USN 递增顺序交给 Resolve 时随目录自身的日志 (创建,
+    // 重命名, 移动等) 更新. 目录自身的日志出现之后, 其下的日志得到的是
+    // 当时的路径.
+    // 局限: 目录自身的日志出现之前, 只能读取磁盘上当前的文件名和位置, 所以
+    // 目录若在日志范围内被重命名或移动, 第一次经由子项的父目录引用遇到它
+    // 时, 重命名之前的日志得到的是重命名之后的路径. 磁盘上的序列号与引用
+    // 不一致 (目录已被删除, 文件记录被重用) 时不使用, 因此已被删除的目录
+    // 只有在其自身的日志先于子项的日志出现时才能解析.
+    // 各目录的完整路径同样被缓存, 有目录的名字或位置改变后全部失效, 通常
+    // 每条日志只需查找一次.
+    struct NtfsUsnPathResolver : NtfsStructureBase {
+        // 日志中文件属性 (Win32 文件属性) 的目录标志
+        static const uint32_t FileAttributeDirectory = 0x10;
+        // 根目录的文件记录号
+        static const uint64_t RootFRN = 5;
+
+        struct Stats {
+            // 解析的日志数
+            uint64_t lookups;
+            // 目录的完整路径直接命中缓存的次数
+            uint64_t pathHits;
+            // 从磁盘读取的目录数
+            uint64_t diskReads;
+            // 引用已失效而无法解析的目录数
+            uint64_t stale;
+            // 日志中目录名字或位置的改变次数
+            uint64_t renames;
+            // 缓存的目录数
+            uint64_t dirs;
+        };
+
+    private:
+        struct Dir {
+            // 文件记录的序列号
+            uint16_t seq;
+            // 磁盘上的文件记录序列号不同, 且日志中还没有出现过
+            bool stale;
+            uint64_t parent;
+            uint16_t parentSeq;
+            std::wstring name;
+            // 以 sep 结尾的完整路径, pathEpoch 等于 epoch 时有效.
+            std::wstring path;
+            uint64_t pathEpoch;
+        };
+
+        Ntfs *pNtfs = nullptr;
+        std::wstring sep = L"\\";
+        std::unordered_map<uint64_t, Dir> dirs;
+        // 有目录的名字或位置改变时递增, 使缓存的完整路径失效.
+        uint64_t epoch = 1;
+        Stats stats = {};
+
+        // 引用 (FRN, seq) 对应的目录, 无法解析时返回 nullptr.
+        Dir *FindDir(uint64_t FRN, uint16_t seq) {
+            auto it = dirs.find(FRN);
+            if (it != dirs.end() && it->second.seq == seq) {
+                return it->second.stale ? nullptr : &it->second;
+            }
+            // 没有见过, 或缓存的是被重用之前 (之后) 的目录
+            FileNameCache::Entry info;
+            Dir dir = {seq, true, 0, 0, L"", L"", 0};
+            stats.diskReads++;
+            if (pNtfs->GetFileNameInfo(FRN, seq, info) && info.seq == seq) {
+                dir.stale = false;
+                dir.parent = info.parent;
+                dir.parentSeq = info.parentSeq;
+                dir.name = info.name;
+            }
+            else {
+                stats.stale++;
+            }
+            if (it != dirs.end()) {
+                it->second = std::move(dir);
+            }
+            else {
+                it = dirs.emplace(FRN, std::move(dir)).first;
+            }
+            return it->second.stale ? nullptr : &it->second;
+        }
+
+        // 用目录自身的日志更新缓存.
+        void Learn(NtfsUsnJrnl::JEntryFixed const &fixed,
+                   std::wstring const &name) {
+            uint64_t FRN = fixed.fileRef.fileRecordNum;
+            uint16_t seq = (uint16_t)fixed.fileRef.seqNum;
+            uint64_t parent = fixed.parentFileRef.fileRecordNum;
+            uint16_t parentSeq = (uint16_t)fixed.parentFileRef.seqNum;
+            auto it = dirs.find(FRN);
+            if (it == dirs.end()) {
+                dirs.emplace(FRN, Dir{seq, false, parent, parentSeq, name,
+                                      L"", 0});
+                return;
+            }
+            Dir &dir = it->second;
+            if (!dir.stale && dir.seq == seq) {
+                if (dir.parent == parent && dir.parentSeq == parentSeq &&
+                    dir.name == name) {
+                    return;
+                }
+                // 子孙目录缓存的路径都已过期
+                stats.renames++;
+                epoch++;
+            }
+            dir = Dir{seq, false, parent, parentSeq, name, L"", 0};
+        }
+
+    public:
+        NtfsUsnPathResolver() = default;
+        NtfsUsnPathResolver(NtfsUsnPathResolver const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+        }
+        NtfsUsnPathResolver &operator=(NtfsUsnPathResolver const &r) {
+            static_cast<NtfsStructureBase &>(*this) = r;
+            return *this;
+        }
+
+        NtfsUsnPathResolver(Ntfs &disk, std::wstring sep = L"\\")
+            : NtfsStructureBase(true), pNtfs(&disk), sep(sep) {
+            if (!disk.valid) {
+                Reset();
+            }
+        }
+
+        // 目录 (FRN, seq) 下的文件的路径 (以 sep 结尾). 中途无法解析时与
+        // Ntfs::GetFilePath 一样只返回已获得的部分 (不以 sep 开头).
+        std::wstring GetDirPath(uint64_t FRN, uint16_t seq) {
+            std::vector<Dir *> levels;
+            std::wstring path;
+            bool complete = false;
+            while (true) {
+                if (!FRN || FRN == RootFRN) {
+                    path = sep;
+                    complete = true;
+                    break;
+                }
+                Dir *dir = FindDir(FRN, seq);
+                if (nullptr == dir || levels.size() >= Ntfs::MaxPathDepth) {
+                    break;
+                }
+                if (dir->pathEpoch == epoch) {
+                    if (levels.empty()) stats.pathHits++;
+                    path = dir->path;
+                    complete = true;
+                    break;
+                }
+                levels.push_back(dir);
+                FRN = dir->parent;
+                seq = dir->parentSeq;
+            }
+            for (auto it = levels.rbegin(); it != levels.rend(); it++) {
+                path += (*it)->name + sep;
+                if (complete) {
+                    (*it)->path = path;
+                    (*it)->pathEpoch = epoch;
+                }
+            }
+            return path;
+        }
+
+        // 日志 entry 发生时文件所在目录的路径 (以 sep 结尾). entry 是目录
+        // 时之后用它更新缓存. 日志应按 USN 递增顺序交给此函数.
+        std::wstring Resolve(NtfsUsnJrnl::JEntry const &entry) {
+            if (!valid) {
+                return L"";
+            }
+            stats.lookups++;
+            std::wstring path =
+                GetDirPath(entry.fixed.parentFileRef.fileRecordNum,
+                           (uint16_t)entry.fixed.parentFileRef.seqNum);
+            if (entry.fixed.fileAttributes & FileAttributeDirectory) {
+                Learn(entry.fixed, entry.fileName);
+            }
+            return path;
+        }
+
+        Stats GetStats() const {
+            Stats ret = stats;
+            ret.dirs = dirs.size();
+            return ret;
+        }
+
+    protected:
+        virtual NtfsUsnPathResolver &
+        Copy(NtfsStructureBase const &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T const &rr = (T const &)r;
+            this->pNtfs = rr.pNtfs;
+            this->sep = rr.sep;
+            this->dirs = rr.dirs;
+            this->epoch = rr.epoch;
+            this->stats = rr.stats;
+            return *this;
+        }
+        virtual NtfsUsnPathResolver &Move(NtfsStructureBase &r) override {
+            using T = std::remove_reference<decltype(*this)>::type;
+            T &rr = (T &)r;
+            this->pNtfs = rr.pNtfs;
+            this->sep = std::move(rr.sep);
+            this->dirs = std::move(rr.dirs);
+            this->epoch = rr.epoch;
+            this->stats = rr.stats;
+            return *this;
+        }
+    };
+}
@@ -20,8 +20,8 @@ namespace abkntfs {
         }
         // 如果是 "具名属性", 则进行名称赋值.
         if (fixedFields.nameLen) {
-            attrName.assign((const wchar_t *)&data[fixedFields.offToName],
-                            fixedFields.nameLen);
+            attrName = Utf16ToWString(&data[fixedFields.offToName],
+                                      fixedFields.nameLen);
         }
         // 如果是 "非驻留" 属性
         if (fixedFields.nonResident) {
@@ -88,11 +88,19 @@ namespace abkntfs {
             uint64_t sectorSize = pNtfs->GetSectorSize();
             uint64_t startingSector = offset / sectorSize;
             uint64_t offInSec = offset - startingSector * sectorSize;
-            uint64_t sectorsNum = 1 + (size + offInSec + 1) / sectorSize;
-            NtfsSectorsInfo dataRunsMap =
-                pNtfs->DataRunsToSectorsInfo((NtfsDataBlock)attrData);
-            NtfsSectorsInfo needToRead =
-                pNtfs->VSN_To_LSN(dataRunsMap, startingSector, sectorsNum);
+            uint64_t sectorsNum =
+                (offInSec + size + sectorSize - 1) / sectorSize;
+            if (!extents) {
+                extents = std::make_shared<NtfsExtentMap>(
+                    pNtfs->DataRunsToSectorsInfo((NtfsDataBlock)attrData));
+            }
+            NtfsSectorsInfo needToRead;
+            try {
+                needToRead = extents->Translate(startingSector, sectorsNum);
+            }
+            catch (std::exception &e) {
+                return ret;
+            }
             ret = NtfsDataBlock{pNtfs->ReadSectors(needToRead),
                                 offset - startingSector * sectorSize, size};
         }
@@ -77,7 +77,7 @@ namespace abkntfs {
             // TypeData &operator=(TypeData const &r) = default;
             // TypeData(TypeData &&r) = default;
             // TypeData &operator=(TypeData &&r) = default;
-            TypeData(NtfsAttr *pAttr, NtfsDataBlock &attrData) {
+            TypeData(NtfsAttr *pAttr, NtfsDataBlock const &attrData) {
                 attrHeader = pAttr->fields;
                 attrName = pAttr->attrName;
                 this->rawData = attrData;
@@ -113,7 +113,7 @@ namespace abkntfs {
 
             // 获取驻留部分属性数据大小
             uint64_t len() const { return rawData.len(); }
-            operator typename NtfsDataBlock const &() const { return rawData; }
+            operator NtfsDataBlock const &() const { return rawData; }
         };
 
     public:
@@ -128,6 +128,8 @@ namespace abkntfs {
         uint64_t fileRecordFrom;
         // 原始数据拷贝, 包含整个属性的数据, 与 attrData 数据独立.
         NtfsDataBlock rawData;
+        // 非驻留属性的扇区映射, 首次读取数据时建立.
+        std::shared_ptr<NtfsExtentMap> extents;
 
         NtfsAttr() = default;
         NtfsAttr(NtfsAttr const &r) {
@@ -231,6 +233,7 @@ namespace abkntfs {
             this->prevAttr = rr.prevAttr;
             this->fileRecordFrom = rr.fileRecordFrom;
             this->rawData = rr.rawData;
+            this->extents = rr.extents;
             return *this;
         }
         virtual NtfsAttr &Move(NtfsStructureBase &r) override {
@@ -242,6 +245,7 @@ namespace abkntfs {
             this->prevAttr = std::move(rr.prevAttr);
             this->fileRecordFrom = rr.fileRecordFrom;
             this->rawData = rr.rawData;
+            this->extents = rr.extents;
             return *this;
         }
     };
@@ -14,6 +14,7 @@ namespace abkntfs {
             NtfsAttr::NonResidentPart &nonRD =
                 (NtfsAttr::NonResidentPart &)*attr.fields.get();
             dataRunsMap = data.pNtfs->DataRunsToSectorsInfo(data, attr);
+            extents = NtfsExtentMap{dataRunsMap};
             VCN_beg = nonRD.VCN_beg;
             VCN_end = nonRD.VCN_end;
             dataSize = nonRD.realSize;
@@ -40,9 +41,15 @@ namespace abkntfs {
             uint64_t sectorSize = pNtfs->GetSectorSize();
             uint64_t startingSector = offset / sectorSize;
             uint64_t offInSec = offset - startingSector * sectorSize;
-            uint64_t sectorsNum = 1 + (size + offInSec + 1) / sectorSize;
-            NtfsSectorsInfo needToRead =
-                pNtfs->VSN_To_LSN(dataRunsMap, startingSector, sectorsNum);
+            uint64_t sectorsNum =
+                (offInSec + size + sectorSize - 1) / sectorSize;
+            NtfsSectorsInfo needToRead;
+            try {
+                needToRead = extents.Translate(startingSector, sectorsNum);
+            }
+            catch (std::exception &e) {
+                return ret;
+            }
             ret = NtfsDataBlock{pNtfs->ReadSectors(needToRead),
                                 offset - startingSector * sectorSize, size};
         }
@@ -53,37 +60,69 @@ namespace abkntfs {
 // AttrData_INDEX_ALLOCATION 定义
 namespace abkntfs {
     AttrData_INDEX_ALLOCATION::AttrData_INDEX_ALLOCATION(
-        NtfsDataBlock &dataRuns, AttrData_INDEX_ROOT &indexRoot)
-        : NtfsStructureBase(true) {
-        secs = dataRuns.pNtfs->DataRunsToSectorsInfo(dataRuns);
-        this->indexRoot = &indexRoot;
-        this->pNtfs = dataRuns.pNtfs;
-        if (this->indexRoot == nullptr || this->pNtfs == nullptr) {
+        NtfsDataBlock const &dataRuns, AttrData_INDEX_ROOT &indexRoot)
+        : NtfsStructureBase(true), pNtfs(dataRuns.pNtfs),
+          rootInfo(indexRoot.rootInfo),
+          cache(std::make_shared<NodeCache>()) {
+        if (this->pNtfs == nullptr || !rootInfo.sizeofIB ||
+            rootInfo.sizeofIB % pNtfs->GetSectorSize()) {
             Reset();
             return;
         }
+        irExtents = NtfsExtentMap{pNtfs->DataRunsToSectorsInfo(dataRuns)};
     }
 
-    std::vector<NtfsIndexRecord> &AttrData_INDEX_ALLOCATION::GetIRs() {
-        if (!this->loaded) {
-            NtfsDataBlock rawIRsData = pNtfs->ReadSectors(secs);
-            if (!rawIRsData.len()) {
-                Reset();
-                return IRs;
-            }
-            uint64_t pos = 0;
-            while (pos < rawIRsData.len()) {
-                NtfsIndexRecord t = {NtfsDataBlock{rawIRsData, pos},
-                                     indexRoot->rootInfo.attrType};
-                // 就算 t 是无效的也要保存记录 (方便通过 索引记录号 查找
-                // 索引记录). if (!t.valid) {
-                //    Reset();
-                //    return;
-                //}
-                this->IRs.push_back(t);
-                pos += indexRoot->rootInfo.sizeofIB;
+    uint64_t AttrData_INDEX_ALLOCATION::GetIRsCount() const {
+        if (!valid) return 0;
+        uint64_t size = irExtents.GetSectorsCount() * pNtfs->GetSectorSize();
+        return (size + rootInfo.sizeofIB - 1) / rootInfo.sizeofIB;
+    }
+
+    std::shared_ptr<NtfsIndexRecord>
+    AttrData_INDEX_ALLOCATION::GetIR(uint64_t n) {
+        if (n >= GetIRsCount()) {
+            return nullptr;
+        }
+        {
+            std::lock_guard<std::mutex> guard(cache->lock);
+            auto it = cache->index.find(n);
+            if (it != cache->index.end()) {
+                cache->lru.splice(cache->lru.begin(), cache->lru, it->second);
+                return it->second->second;
             }
         }
-        return IRs;
+        uint64_t secPerIB = rootInfo.sizeofIB / pNtfs->GetSectorSize();
+        uint64_t vsn = n * secPerIB;
+        // 最后一个索引记录可能不完整
+        uint64_t num = std::min(secPerIB, irExtents.GetSectorsCount() - vsn);
+        std::shared_ptr<NtfsIndexRecord> ret;
+        try {
+            ret = std::make_shared<NtfsIndexRecord>(
+                pNtfs->ReadSectors(irExtents.Translate(vsn, num)),
+                rootInfo.attrType);
+        }
+        catch (std::exception &e) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> guard(cache->lock);
+        if (cache->index.count(n)) {
+            return ret;
+        }
+        cache->lru.emplace_front(n, ret);
+        cache->index[n] = cache->lru.begin();
+        if (cache->lru.size() > DefaultNodeCacheSize) {
+            cache->index.erase(cache->lru.back().first);
+            cache->lru.pop_back();
+        }
+        return ret;
+    }
+
+    std::shared_ptr<NtfsIndexRecord>
+    AttrData_INDEX_ALLOCATION::GetIRByVCN(uint64_t VCN) {
+        if (!valid) return nullptr;
+        uint64_t clusterSize = (uint64_t)pNtfs->bootInfo.sectorsPerCluster *
+                               pNtfs->GetSectorSize();
+        uint64_t unit = clusterSize <= rootInfo.sizeofIB ? clusterSize : 512;
+        return GetIR(VCN * unit / rootInfo.sizeofIB);
     }
 }
@@ -1,5 +1,7 @@
 #pragma once
 #include "ntfs_access.hpp"
+#include <list>
+#include <mutex>
 
 namespace abkntfs {
     struct AttrData_STANDARD_INFOMATION : NtfsStructureBase {
@@ -133,7 +135,7 @@ namespace abkntfs {
             return *this;
         }
 
-        AttrData_ATTRIBUTE_LIST(NtfsDataBlock &data) : NtfsStructureBase(true) {
+        AttrData_ATTRIBUTE_LIST(NtfsDataBlock const &data) : NtfsStructureBase(true) {
             NtfsDataBlock remainingData = data;
             ListItem t;
             if (sizeof(Info) > remainingData.len()) {
@@ -147,9 +149,9 @@ namespace abkntfs {
                     return;
                 }
                 if (t.info.nameLength.lenInWords) {
-                    t.attrName.resize(t.info.nameLength.lenInWords);
-                    memcpy(&t.attrName[0], remainingData + t.info.offToName,
-                           (uint64_t)t.info.nameLength.lenInWords << 1);
+                    t.attrName =
+                        Utf16ToWString(remainingData + t.info.offToName,
+                                       t.info.nameLength.lenInWords);
                 }
                 list.push_back(t);
                 remainingData = NtfsDataBlock{remainingData, t.info.length};
@@ -188,6 +190,14 @@ namespace abkntfs {
             FILE_FLAG_INDEX_VIEW = 0x20000000
         };
 
+        enum NAME_SPACE : uint8_t {
+            NAME_SPACE_POSIX = 0,
+            NAME_SPACE_WIN32 = 1,
+            // 8.3 短文件名
+            NAME_SPACE_DOS = 2,
+            NAME_SPACE_WIN32_AND_DOS = 3,
+        };
+
 #pragma pack(push, 1)
         struct FileInfo {
             // 到父级目录的文件引用
@@ -212,8 +222,8 @@ namespace abkntfs {
             uint32_t EAs_Reparse;
             // 文件名字符数 (UTF16-LE)
             uint8_t filenameLen;
-            // 填充
-            uint8_t padding;
+            // 文件名的名字空间, 见 NAME_SPACE
+            uint8_t nameSpace;
         } fileInfo;
 #pragma pack(pop)
         // 名字空间
@@ -240,8 +250,8 @@ namespace abkntfs {
                 Reset();
                 return;
             }
-            filename.assign((wchar_t *)&data[sizeof(fileInfo)],
-                            fileInfo.filenameLen);
+            filename = Utf16ToWString(&data[sizeof(fileInfo)],
+                                      fileInfo.filenameLen);
         }
 
     protected:
@@ -273,6 +283,8 @@ namespace abkntfs {
 
     public:
         NtfsSectorsInfo dataRunsMap;
+        // 由 dataRunsMap 建立, 用于读取时的扇区转换
+        NtfsExtentMap extents;
         uint64_t VCN_beg, VCN_end;
 
     public:
@@ -297,6 +309,7 @@ namespace abkntfs {
             T const &rr = (T const &)r;
             this->pNtfs = rr.pNtfs;
             this->dataRunsMap = rr.dataRunsMap;
+            this->extents = rr.extents;
             this->residentData = rr.residentData;
             this->isResident = rr.isResident;
             this->VCN_beg = rr.VCN_beg;
@@ -310,6 +323,7 @@ namespace abkntfs {
             T &rr = (T &)r;
             this->pNtfs = rr.pNtfs;
             this->dataRunsMap = std::move(rr.dataRunsMap);
+            this->extents = std::move(rr.extents);
             this->residentData = rr.residentData;
             this->isResident = rr.isResident;
             this->VCN_beg = rr.VCN_beg;
@@ -438,18 +452,33 @@ namespace abkntfs {
         }
     };
 
+    // 索引记录按需读取, 读取过的索引记录放在每个索引独立的 LRU 缓存中.
     struct AttrData_INDEX_ALLOCATION : NtfsStructureBase {
+        // 每个索引默认缓存的索引记录数
+        static const uint32_t DefaultNodeCacheSize = 64;
+
     private:
-        // NtfsDataBlock rawIRsData;
-        std::vector<NtfsIndexRecord> IRs;
-        bool loaded = false;
-        NtfsSectorsInfo secs;
+        // 按索引记录号缓存, 最近使用的在前面.
+        struct NodeCache {
+            std::mutex lock;
+            std::list<std::pair<uint64_t, std::shared_ptr<NtfsIndexRecord>>>
+                lru;
+            std::unordered_map<
+                uint64_t, std::list<std::pair<
+                              uint64_t, std::shared_ptr<NtfsIndexRecord>>>::
+                              iterator>
+                index;
+        };
+
+        NtfsExtentMap irExtents;
         Ntfs *pNtfs = nullptr;
-        AttrData_INDEX_ROOT *indexRoot = nullptr;
+        AttrData_INDEX_ROOT::IndexRootInfo rootInfo;
+        // 拷贝之间共享
+        std::shared_ptr<NodeCache> cache;
 
     public:
         AttrData_INDEX_ALLOCATION() = default;
-        AttrData_INDEX_ALLOCATION(AttrData_INDEX_ALLOCATION &r) {
+        AttrData_INDEX_ALLOCATION(AttrData_INDEX_ALLOCATION const &r) {
             static_cast<NtfsStructureBase &>(*this) = r;
         }
         AttrData_INDEX_ALLOCATION &
@@ -458,22 +487,29 @@ namespace abkntfs {
             return *this;
         }
 
-        AttrData_INDEX_ALLOCATION(NtfsDataBlock &dataRuns,
+        AttrData_INDEX_ALLOCATION(NtfsDataBlock const &dataRuns,
                                   AttrData_INDEX_ROOT &indexRoot);
 
-        std::vector<NtfsIndexRecord> &GetIRs();
+        // 索引记录的数量 (包括无效的)
+        uint64_t GetIRsCount() const;
+
+        // 读取第 n 个索引记录, 超出范围或读取失败时返回 nullptr. 索引记录
+        // 本身可能是无效的.
+        std::shared_ptr<NtfsIndexRecord> GetIR(uint64_t n);
+
+        // 按索引项中指向子节点的 VCN 读取索引记录. 索引记录不小于簇时 VCN
+        // 以簇为单位, 否则以 512 字节为单位.
+        std::shared_ptr<NtfsIndexRecord> GetIRByVCN(uint64_t VCN);
 
     protected:
         virtual AttrData_INDEX_ALLOCATION &
         Copy(NtfsStructureBase const &r) override {
             using T = std::remove_reference<decltype(*this)>::type;
             T const &rr = (T const &)r;
-            // this->rawIRsData = rr.rawIRsData;
-            this->IRs = rr.IRs;
-            this->loaded = rr.loaded;
-            this->secs = rr.secs;
+            this->irExtents = rr.irExtents;
             this->pNtfs = rr.pNtfs;
-            this->indexRoot = rr.indexRoot;
+            this->rootInfo = rr.rootInfo;
+            this->cache = rr.cache;
             return *this;
         }
         virtual AttrData_INDEX_ALLOCATION &Move(NtfsStructureBase &r) override {
@@ -500,7 +536,8 @@ namespace abkntfs {
             return *this;
         }
 
-        TypeData_BITMAP(NtfsDataBlock &data, BITMAP_UNIT unit) {
+        TypeData_BITMAP(NtfsDataBlock const &data, BITMAP_UNIT unit)
+            : NtfsStructureBase(true) {
             if (!data.len()) {
                 Reset();
                 return;
@@ -512,13 +549,35 @@ namespace abkntfs {
         bool CheckPos(uint64_t pos) {
             uint64_t offInBytes = pos / 8;
             uint64_t offInBits = pos - offInBytes * 8;
-            if (offInBytes > bitmap.len()) {
+            if (offInBytes >= bitmap.len()) {
                 throw std::runtime_error("offset outbound.");
             }
             uint8_t byte = bitmap[offInBytes];
             return byte & (1 << offInBits);
         }
 
+        // 从 pos 开始查找第一个被使用的单元, 整字节为 0 时直接跳过. 没有
+        // 返回 (uint64_t)-1.
+        uint64_t FindUsedUnitPos(uint64_t pos) const {
+            uint64_t offInBytes = pos / 8;
+            while (offInBytes < bitmap.len()) {
+                uint8_t byte = bitmap[offInBytes];
+                // 第一个字节要去掉 pos 之前的位
+                if (offInBytes == pos / 8) {
+                    byte &= (uint8_t)(0xFF << (pos % 8));
+                }
+                if (byte) {
+                    uint64_t offInBits = 0;
+                    while (!(byte & (1 << offInBits))) {
+                        offInBits++;
+                    }
+                    return offInBytes * 8 + offInBits;
+                }
+                offInBytes++;
+            }
+            return (uint64_t)-1;
+        }
+
         // TODO: 待优化; 没有返回 (uint64_t) -1
         uint64_t FindFreeUnitPos() {
             uint64_t offInBytes = 0;
@@ -2,13 +2,13 @@
 
 // Ntfs_FILE_Record 定义
 namespace abkntfs {
-    NtfsFileRecord::NtfsFileRecord(NtfsDataBlock const &data, uint64_t FRN)
+    NtfsFileRecord::NtfsFileRecord(NtfsDataBlock const &record, uint64_t FRN)
         : NtfsStructureBase(true), FRN(FRN) {
-        if (data.len() < sizeof(fixedFields)) {
+        if (record.len() < sizeof(fixedFields)) {
             Reset();
             return;
         }
-        memcpy_s(&fixedFields, sizeof(fixedFields), &data[0],
+        memcpy_s(&fixedFields, sizeof(fixedFields), &record[0],
                  sizeof(fixedFields));
         if (memcmp(fixedFields.magicNumber, "FILE", 4)) {
             Reset();
@@ -16,14 +16,17 @@ namespace abkntfs {
         }
         if ((uint64_t)fixedFields.offsetToUS +
                 (uint64_t)fixedFields.sizeInWordOfUSN * 2 + 2 >=
-            data.len()) {
+            record.len()) {
             Reset();
             return;
         }
-        USN = *(uint16_t *)(&data[fixedFields.offsetToUS]);
+        USN = *(uint16_t *)(&record[fixedFields.offsetToUS]);
         USA.resize(((uint64_t)fixedFields.sizeInWordOfUSN - 1) << 1);
         memcpy_s(USA.data(), USA.size(),
-                 &data[(uint64_t)fixedFields.offsetToUS + 2], USA.size());
+                 &record[(uint64_t)fixedFields.offsetToUS + 2], USA.size());
+        // 数据修正需要改写数据, 只读视图(内存映射) 要先拷贝一份.
+        NtfsDataBlock data =
+            record.IsReadOnly() && !USA.empty() ? record.Copy() : record;
         // 进行数据修正
         uint16_t &sectorSize = data.pNtfs->bootInfo.bytesPerSector;
         for (uint64_t i = 0; i < (USA.size() >> 1); i++) {
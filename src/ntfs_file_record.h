@@ -78,6 +78,23 @@ namespace abkntfs {
             return pFn->filename;
         }
 
+        // 在所有 $FILE_NAME 中优先选择非 DOS 名字空间的 (长文件名), 只有
+        // 8.3 短文件名时返回它. 失败返回 nullptr.
+        AttrData_FILE_NAME *PickFileName() {
+            AttrData_FILE_NAME *ret = nullptr;
+            for (auto &p : attrs) {
+                if (p.get()->GetAttributeType() != NTFS_FILE_NAME) continue;
+                AttrData_FILE_NAME &fn = p.get()->attrData;
+                if (!fn.valid) continue;
+                if (fn.fileInfo.nameSpace !=
+                    AttrData_FILE_NAME::NAME_SPACE_DOS) {
+                    return &fn;
+                }
+                if (nullptr == ret) ret = &fn;
+            }
+            return ret;
+        }
+
         // 失败返回 nullptr.
         NtfsAttr::TypeData *FindSpecAttrData(NTFS_ATTRIBUTES_TYPE const type,
                                              std::wstring attrName = L"*",
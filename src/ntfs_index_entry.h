@@ -48,8 +48,8 @@ namespace abkntfs {
             return *this;
         }
 
-        NtfsIndexEntry::NtfsIndexEntry(NtfsDataBlock &data,
-                                       NTFS_ATTRIBUTES_TYPE streamType)
+        NtfsIndexEntry(NtfsDataBlock const &data,
+                       NTFS_ATTRIBUTES_TYPE streamType)
             : NtfsStructureBase(true), streamType(streamType) {
             if (data.len() < sizeof(entryHeader)) {
                 Reset();
@@ -72,14 +72,9 @@ namespace abkntfs {
                 Reset();
                 return;
             }
-            // 流数据进行拷贝而不是建立视图.
-            stream = NtfsDataBlock(
-                std::vector<char>((char *)data + sizeof(entryHeader),
-                                  data + sizeof(entryHeader) +
-                                      entryHeader.lengthOfStream),
-                data.pNtfs);
-            // stream = NtfsDataBlock{data, sizeof(entryHeader),
-            //                        entryHeader.lengthOfStream};
+            // 流数据建立视图而不是拷贝, 与所在的索引记录共享缓冲区.
+            stream = NtfsDataBlock{data, sizeof(entryHeader),
+                                   entryHeader.lengthOfStream};
             // 额外数据即为指向 根节点的 索引记录号
             NtfsDataBlock remainingData = NtfsDataBlock{
                 data, sizeof(entryHeader) + entryHeader.lengthOfStream,
@@ -31,7 +31,7 @@ namespace abkntfs {
             static_cast<NtfsStructureBase &>(*this) = r;
             return *this;
         }
-        NtfsIndexNode(NtfsDataBlock &data, NTFS_ATTRIBUTES_TYPE streamType)
+        NtfsIndexNode(NtfsDataBlock const &data, NTFS_ATTRIBUTES_TYPE streamType)
             : NtfsStructureBase(true) {
             // 数据大小必须要大于 索引节点头 的大小
             if (errno || data.len() < sizeof(NtfsIndexNode::IndexNodeHeader)) {
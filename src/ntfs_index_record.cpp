@@ -2,15 +2,15 @@
 
 // NtfsIndexRecord 定义
 namespace abkntfs {
-    NtfsIndexRecord::NtfsIndexRecord(NtfsDataBlock &data,
+    NtfsIndexRecord::NtfsIndexRecord(NtfsDataBlock const &record,
                                      NTFS_ATTRIBUTES_TYPE streamType)
         : NtfsStructureBase(true), US(0) {
-        if (data.len() < sizeof(standardIndexHeader)) {
+        if (record.len() < sizeof(standardIndexHeader)) {
             Reset();
             return;
         }
         errno = memcpy_s(&standardIndexHeader, sizeof(standardIndexHeader),
-                         data, sizeof(standardIndexHeader));
+                         record, sizeof(standardIndexHeader));
         // 判断 索引标志
         if (memcmp(&standardIndexHeader.magicNum, "INDX",
                    sizeof(standardIndexHeader.magicNum))) {
@@ -18,16 +18,19 @@ namespace abkntfs {
             return;
         }
         // 获取 US 和 USA
-        this->US = *(uint16_t *)&data[standardIndexHeader.offToUS];
+        this->US = *(uint16_t *)&record[standardIndexHeader.offToUS];
         this->USA.resize(
             (uint64_t)(standardIndexHeader.sizeInWordsOfUSNandUSA - 1) << 1);
-        memcpy(USA.data(), &data[(uint64_t)standardIndexHeader.offToUS + 2],
+        memcpy(USA.data(), &record[(uint64_t)standardIndexHeader.offToUS + 2],
                USA.size());
         // 进行数据修正
-        if ((USA.size() >> 1) * data.pNtfs->GetSectorSize() > data.len()) {
+        if ((USA.size() >> 1) * record.pNtfs->GetSectorSize() > record.len()) {
             Reset();
             return;
         }
+        // 数据修正需要改写数据, 只读视图(内存映射) 要先拷贝一份.
+        NtfsDataBlock data =
+            record.IsReadOnly() && !USA.empty() ? record.Copy() : record;
         for (uint64_t i = 0; i < (USA.size() >> 1); i++) {
             memcpy(&data[data.pNtfs->GetSectorSize() * (i + 1) - 2],
                    &USA[i << 1], 2);
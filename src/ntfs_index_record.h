@@ -38,7 +38,7 @@ namespace abkntfs {
             return *this;
         }
 
-        NtfsIndexRecord(NtfsDataBlock &data, NTFS_ATTRIBUTES_TYPE streamType);
+        NtfsIndexRecord(NtfsDataBlock const &data, NTFS_ATTRIBUTES_TYPE streamType);
 
         // 创建新 索引记录
         // NtfsIndexRecord(std::vector<NtfsIndexEntry> const &indexEntries,
@@ -0,0 +1,184 @@
+#pragma once
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ABKNTFS_UPCASE_SSE2
+#endif
+
+namespace abkntfs {
+    // $UpCase 大写映射表, 以及 $I30 索引使用的文件名排序规则
+    // (COLLATION_RULE_FILENAME): 逐个 UTF-16 码元转为大写后按数值比较.
+    // 与区域设置无关, 也不依赖 wchar_t 的宽度.
+    class NtfsUpCase {
+        std::vector<uint16_t> table;
+        // 表中 ASCII 部分是否只把 a-z 转为 A-Z, 是则可按 8 个码元一组转换.
+        bool asciiFast = true;
+
+        static uint16_t Load16(char const *p, uint64_t i) {
+            uint16_t c;
+            memcpy(&c, p + (i << 1), sizeof(c));
+            return c;
+        }
+
+        void CheckAscii() {
+            asciiFast = true;
+            for (uint16_t c = 0; c < 0x80; c++) {
+                uint16_t u = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+                if (table[c] != u) asciiFast = false;
+            }
+        }
+
+        // 依次取出 wchar_t 串的 UTF-16 码元, 32 位的 wchar_t 拆成代理对.
+        struct Utf16Units {
+            wchar_t const *p;
+            wchar_t const *end;
+            uint16_t low = 0;
+
+            bool Next(uint16_t &unit) {
+                if (low) {
+                    unit = low;
+                    low = 0;
+                    return true;
+                }
+                if (p == end) return false;
+                uint32_t cp = (uint32_t)*p++;
+                if (cp >= 0x10000 && cp < 0x110000) {
+                    cp -= 0x10000;
+                    unit = (uint16_t)(0xD800 + (cp >> 10));
+                    low = (uint16_t)(0xDC00 + (cp & 0x3FF));
+                    return true;
+                }
+                unit = (uint16_t)cp;
+                return true;
+            }
+        };
+
+#ifdef ABKNTFS_UPCASE_SSE2
+        // 把 8 个 ASCII 码元中的 a-z 转为大写.
+        static __m128i FoldAscii(__m128i v) {
+            __m128i lower =
+                _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16('a' - 1)),
+                              _mm_cmplt_epi16(v, _mm_set1_epi16('z' + 1)));
+            return _mm_sub_epi16(v,
+                                 _mm_and_si128(lower, _mm_set1_epi16(0x20)));
+        }
+#endif
+
+        // 逐个码元比较 [beg, end), 全部相同返回 0.
+        int CompareUnits(char const *a, char const *b, uint64_t beg,
+                         uint64_t end) const {
+            for (uint64_t i = beg; i < end; i++) {
+                uint16_t ca = table[Load16(a, i)];
+                uint16_t cb = table[Load16(b, i)];
+                if (ca != cb) {
+                    return ca < cb ? -1 : 1;
+                }
+            }
+            return 0;
+        }
+
+    public:
+        // 表项数, 覆盖全部 UTF-16 码元.
+        static const uint32_t TableEntries = 0x10000;
+
+        // 缺省表只转换 ASCII 字母, 用于无法读取 $UpCase 的情况.
+        NtfsUpCase() : table(TableEntries) {
+            for (uint32_t i = 0; i < TableEntries; i++) {
+                table[i] = (uint16_t)i;
+            }
+            for (uint16_t c = 'a'; c <= 'z'; c++) {
+                table[c] = c - 'a' + 'A';
+            }
+        }
+
+        // data: $UpCase 的内容 (UTF-16LE), 长度不足的部分使用缺省表.
+        NtfsUpCase(char const *data, uint64_t len) : NtfsUpCase() {
+            uint64_t n = len / sizeof(uint16_t);
+            if (n > TableEntries) n = TableEntries;
+            memcpy(table.data(), data, n * sizeof(uint16_t));
+            CheckAscii();
+        }
+
+        static NtfsUpCase const &Default() {
+            static NtfsUpCase const def;
+            return def;
+        }
+
+        uint16_t ToUpper(uint16_t c) const { return table[c]; }
+
+        // 按文件名排序规则比较两个 UTF-16LE 串 (不要求对齐, 长度单位为
+        // 码元), 返回值小于, 等于, 大于 0 分别表示 a 排在 b 之前, 与 b 相同
+        // (不区分大小写), 排在 b 之后. 连续的 ASCII 码元每 8 个一组比较.
+        int Compare(char const *a, uint64_t aLen, char const *b,
+                    uint64_t bLen) const {
+            uint64_t n = aLen < bLen ? aLen : bLen;
+            uint64_t i = 0;
+#ifdef ABKNTFS_UPCASE_SSE2
+            if (asciiFast) {
+                __m128i const nonAscii = _mm_set1_epi16((short)0xFF80);
+                __m128i const zero = _mm_setzero_si128();
+                for (; i + 8 <= n; i += 8) {
+                    __m128i va = _mm_loadu_si128((__m128i const *)(a + 2 * i));
+                    __m128i vb = _mm_loadu_si128((__m128i const *)(b + 2 * i));
+                    __m128i high =
+                        _mm_and_si128(_mm_or_si128(va, vb), nonAscii);
+                    if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) !=
+                        0xFFFF) {
+                        int r = CompareUnits(a, b, i, i + 8);
+                        if (r) return r;
+                        continue;
+                    }
+                    __m128i eq =
+                        _mm_cmpeq_epi16(FoldAscii(va), FoldAscii(vb));
+                    if (_mm_movemask_epi8(eq) != 0xFFFF) {
+                        return CompareUnits(a, b, i, i + 8);
+                    }
+                }
+            }
+#endif
+            int r = CompareUnits(a, b, i, n);
+            if (r) return r;
+            if (aLen == bLen) return 0;
+            return aLen < bLen ? -1 : 1;
+        }
+
+        int Compare(char16_t const *a, uint64_t aLen, char16_t const *b,
+                    uint64_t bLen) const {
+            return Compare((char const *)a, aLen, (char const *)b, bLen);
+        }
+
+        // 比较 std::wstring 中的名字. Windows 下 wchar_t 即 UTF-16 码元;
+        // 其他平台按码元展开后比较, 与磁盘上的顺序一致.
+        int Compare(wchar_t const *a, uint64_t aLen, wchar_t const *b,
+                    uint64_t bLen) const {
+#ifdef _WIN32
+            return Compare((char const *)a, aLen, (char const *)b, bLen);
+#else
+            Utf16Units ua{a, a + aLen};
+            Utf16Units ub{b, b + bLen};
+            while (true) {
+                uint16_t ca, cb;
+                bool hasA = ua.Next(ca);
+                bool hasB = ub.Next(cb);
+                if (!hasA || !hasB) {
+                    return hasA == hasB ? 0 : (hasA ? 1 : -1);
+                }
+                ca = table[ca];
+                cb = table[cb];
+                if (ca != cb) {
+                    return ca < cb ? -1 : 1;
+                }
+            }
+#endif
+        }
+
+        int Compare(std::wstring const &a, std::wstring const &b) const {
+            return Compare(a.data(), a.size(), b.data(), b.size());
+        }
+    };
+}